@@ -0,0 +1,144 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+
+namespace kop {
+
+	constexpr const int anyNumaNode = -1;
+	constexpr const int localNumaNode = -2;
+
+
+	size_t getPageSize(bool hugePages);
+	void* allocatePages(
+		size_t size, bool hugePages, int numaNode = anyNumaNode
+	);
+	void freePages(void* data, size_t size);
+
+
+	class CountingAllocator : public cv::MatAllocator {
+	public:
+		CountingAllocator() = default;
+		~CountingAllocator() override = default;
+		cv::UMatData* allocate(
+			int dims, const int* sizes, int type, void* data,
+			size_t* step, cv::AccessFlag flags,
+			cv::UMatUsageFlags usageFlags
+		) const override;
+		bool allocate(
+			cv::UMatData* data, cv::AccessFlag accessFlags,
+			cv::UMatUsageFlags usageFlags
+		) const override;
+		void deallocate(cv::UMatData* data) const override;
+	public:
+		static void install();
+		static uint64_t getTotalAllocations();
+		static uint64_t getThreadAllocations();
+	private:
+		static std::atomic<uint64_t> totalAllocations;
+		static thread_local uint64_t threadAllocations;
+	};
+
+
+	struct ArenaStats {
+	public:
+		uint64_t allocations = 0;
+		uint64_t bytes = 0;
+		uint64_t overflowAllocations = 0;
+		uint64_t overflowBytes = 0;
+	};
+
+
+	class FrameArena : public cv::MatAllocator {
+	public:
+		class Scope {
+		public:
+			Scope(FrameArena& arena);
+			~Scope();
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		private:
+			FrameArena* previous = nullptr;
+		};
+	public:
+		FrameArena() = default;
+		~FrameArena() override;
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+		bool reserve(
+			size_t capacity, bool hugePages = false,
+			int numaNode = anyNumaNode
+		);
+		void free();
+		bool reset();
+		size_t getCapacity() const;
+		size_t getLiveAllocations() const;
+		ArenaStats getFrameStats() const;
+		cv::UMatData* allocate(
+			int dims, const int* sizes, int type, void* data,
+			size_t* step, cv::AccessFlag flags,
+			cv::UMatUsageFlags usageFlags
+		) const override;
+		bool allocate(
+			cv::UMatData* data, cv::AccessFlag accessFlags,
+			cv::UMatUsageFlags usageFlags
+		) const override;
+		void deallocate(cv::UMatData* data) const override;
+		cv::UMatData* tryAllocate(
+			int dims, const int* sizes, int type, size_t* step
+		) const;
+		void recordOverflow(size_t bytes) const;
+	public:
+		static FrameArena* getThreadArena();
+		static constexpr const size_t alignment = 64;
+	private:
+		unsigned char* memory = nullptr;
+		size_t capacity = 0;
+		bool hugePages = false;
+		int numaNode = anyNumaNode;
+		mutable size_t offset = 0;
+		mutable std::atomic<size_t> liveAllocations = 0;
+		mutable ArenaStats currentStats;
+		ArenaStats frameStats;
+	private:
+		static thread_local FrameArena* threadArena;
+	};
+
+
+	class FramePool {
+	public:
+		FramePool() = default;
+		~FramePool();
+		FramePool(const FramePool&) = delete;
+		FramePool& operator=(const FramePool&) = delete;
+		bool allocate(
+			size_t numBuffers, int rows, int cols, int type,
+			bool hugePages = false
+		);
+		void free();
+		bool isAllocated() const;
+		int lease();
+		void retain(int handle);
+		void release(int handle);
+		const cv::Mat& at(int handle) const;
+		bool owns(const cv::Mat& image) const;
+		size_t getNumBuffers() const;
+		size_t getNumLeased() const;
+		uint64_t getFailedLeases() const;
+	public:
+		static constexpr const int nullHandle = -1;
+	private:
+		unsigned char* memory = nullptr;
+		size_t memorySize = 0;
+		size_t bufferStride = 0;
+		std::vector<cv::Mat> buffers = {};
+		std::vector<int> refCounts = {};
+		std::vector<int> freeHandles = {};
+		mutable std::mutex locker;
+		uint64_t failedLeases = 0;
+	};
+
+}
\ No newline at end of file
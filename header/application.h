@@ -1,50 +1,61 @@
 #pragma once
 #include "renderer.h"
-#include <opencv2/videoio.hpp>
+#include "processor.h"
+#include "publisher.h"
+#include "quality.h"
+#include "sweep.h"
+#include "thread.h"
+#include "webcam.h"
 #include <imgui.h>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <mutex>
+#include <string>
+#include <thread>
 
 
 namespace kop {
 
-	class Webcam {
+	struct LoopStats {
 	public:
-		Webcam(
-			unsigned int cameraId,
-			int width,
-			int height
-		);
-		~Webcam();
-		bool isActive() const;
-		void setActive(bool newState);
-		int getWidth() const;
-		int getHeight() const;
-		void getFrame(cv::Mat& image) const;
-		void openSettings();
-		void setMafOrder(size_t order);
+		void update(bool isProcessed);
 	public:
-		static constexpr const size_t maxMafOrder = 5;
-		static const cv::Scalar nullColor;
-	private:
-		void streamingThread();
-		void threadLoop();
-	private:
-		unsigned int cameraId = NULL;
-		int width = NULL;
-		int height = NULL;
-		cv::VideoCapture camera;
-		mutable std::mutex activeLocker;
-		bool stateActive = false;
-		mutable std::mutex frameLocker;
-		cv::Mat rgbFrame = cv::Mat();
-		mutable std::mutex orderLocker;
-		size_t mafOrder = 1;
+		double presentedPerSecond = 0.0;
+		double processedPerSecond = 0.0;
+		double cpuUsage = 0.0;
+	public:
+		static constexpr const std::chrono::milliseconds window =
+			std::chrono::milliseconds(1000);
 	private:
-		static bool movingAverageFilter(
-			size_t order, cv::Mat& image,
-			std::array<cv::Mat, maxMafOrder>& buffer
-		);
+		uint64_t presentedFrames = 0;
+		uint64_t processedFrames = 0;
+		std::chrono::steady_clock::time_point windowStart =
+			std::chrono::steady_clock::now();
+		double windowCpuSeconds = getProcessCpuSeconds();
+	};
+
+
+	struct PipelineSettings {
+	public:
+		std::array<float, 3> lowerHSV = {};
+		std::array<float, 3> upperHSV = {};
+		bool blobsEnabled = false;
+		int blobMinArea = 0;
+		bool roiTracking = false;
+		int roiRefreshInterval = 0;
+		int blurSize = 0;
+		int blurType = 0;
+		int pyramidLevel = 0;
+		bool histogramsEnabled = false;
+		float histogramDecay = 0.0f;
+		cv::Rect calibrationRegion = cv::Rect();
+		bool graphEnabled = false;
+		uint64_t graphLoads = 0;
+	public:
+		bool operator==(const PipelineSettings& other) const;
+		bool operator!=(const PipelineSettings& other) const;
 	};
 
 
@@ -53,33 +64,137 @@ namespace kop {
 		Application(Webcam& webcam, Renderer& renderer);
 		~Application() = default;
 		void run();
+		void setArenaOptions(bool hugePages, int numaNode);
+		void setRecordingPath(const std::string& path);
+		void setPublishName(const std::string& name, bool packedMask = false);
+		void setViewRecordingPath(const std::string& path, bool startNow);
+		bool loadSweepLabels(const std::string& path);
+		bool loadGraph(const std::string& path);
+		const std::string& getGraphError() const;
 	private:
 		void createOriginalRect();
 		void createFilteredRect();
+		void createOverlay();
+		bool reserveArena();
+		bool createPublisher();
+		bool resizeFrames(const cv::Size& size);
 		bool acquireImages();
+		void uploadTexture(
+			const cv::Mat& image, const DirtyTiles& tiles, size_t index
+		);
+		void uploadFrames();
+		TemporalFilter getTemporalFilter() const;
+		QualitySettings getQualityBaseline() const;
+		bool isFrameSkipped(int frameSkip) const;
+		void waitForEvents();
+		PipelineSettings getPipelineSettings(const QualitySettings& quality) const;
+		bool getFramePoint(cv::Point& point) const;
+		void updateRegionSelection();
+		void calibrateRange();
 		void initGUIFrame() const;
 		void addGUIColorPickers();
 		void addGUIWebcamSettings();
+		void addGUIBlobs();
+		void addGUITracking();
+		void addGUIPyramid();
+		void addGUIQuality();
+		void addGUISweep();
+		void addGUICalibration();
+		void addGUIGraph();
+		void addGUIViewRecording();
+		void addGUISmoothing();
+		void addGUITemporal();
+		void addGUIMemoryStats();
+		void addGUILoopStats();
 		void renderGUIFrame() const;
 	private:
 		Webcam* webcam = nullptr;
 		Renderer* renderer = nullptr;
+		cv::Size frameSize = cv::Size();
+		int captureResolution = -1;
+		int captureFormat = 0;
+		double resizeMillis = 0.0;
 		ImGuiWindowFlags imguiWindowFlags = NULL;
 		ImGuiColorEditFlags imguiColorEditFlags = NULL;
 		ImGuiSliderFlags imguiSliderFlags = NULL;
 		std::array<float, 3> inLowerHSV = { 0.00f, 0.20f, 0.20f };
 		std::array<float, 3> inUpperHSV = { 0.15f, 1.00f, 1.00f };
-		std::array<float, 3> outLowerHSV = { NULL, NULL, NULL };
-		std::array<float, 3> outUpperHSV = { NULL, NULL, NULL };
-		cv::Mat rgbFrame;
-		cv::Mat blurredFrame;
-		cv::Mat hsvImage;
-		cv::Mat hsvMask;
-		cv::Mat originalFrame;
-		cv::Mat filteredFrame;
+		Processor processor;
+		bool arenaHugePages = false;
+		int arenaNumaNode = anyNumaNode;
+		bool isArenaReserved = true;
+		std::string recordingPath = "capture.kraw";
+		std::string publishName = std::string();
+		bool publishPacked = false;
+		FramePublisher publisher;
+		bool isPublishPending = false;
+		uint64_t publishedSequence = 0;
 		Object originalRect;
 		Object filteredRect;
+		Object overlay;
+		bool blobsEnabled = true;
+		int blobMinArea = 64;
+		bool roiTracking = false;
+		int roiRefreshInterval = 30;
+		int pyramidLevel = 0;
+		int blurSize = Processor::defaultBlurSize;
+		int blurType = static_cast<int>(BlurType::Gaussian);
+		std::array<double, numBlurTypes> blurBenchmark = {};
+		QualityController qualityController;
+		float qualityTargetMillis = static_cast<float>(
+			QualityController::defaultTargetMillis
+		);
+		uint64_t processedSequence = 0;
+		uint64_t observedSequence = 0;
+		bool eventDriven = true;
+		int pendingRedraws = 0;
+		uint64_t wakeupSequence = 0;
+		PipelineSettings processedPipeline;
+		uint64_t graphLoads = 0;
+		LoopStats loopStats;
+		ThresholdSweep thresholdSweep;
+		cv::Mat sweepLabels;
+		std::vector<SweepResult> sweepResults = {};
+		size_t sweepCandidates = 0;
+		double sweepMillis = 0.0;
+		bool histogramsEnabled = false;
+		float histogramDecay = HsvStatistics::defaultDecay;
+		float calibrationCoverage = 0.95f;
+		cv::Rect calibrationRegion = cv::Rect();
+		cv::Rect selectionRegion = cv::Rect();
+		cv::Point dragOrigin = cv::Point();
+		bool isDragging = false;
+		bool pendingCalibration = false;
+		double calibrationMicros = 0.0;
+		ProcessingGraph graph;
+		bool graphEnabled = false;
+		std::string graphSchedule = std::string();
+		std::string viewRecordingPath = "session.avi";
+		bool recordViewOnStart = false;
 		int mafOrder = 1;
+		bool gpuTemporal = false;
+		int temporalMode = static_cast<int>(TemporalMode::Mean);
+		int temporalDepth = 4;
+		float temporalDecay = 0.6f;
+		bool historyWasActive = false;
+		uint64_t historySequence = 0;
+	public:
+		static constexpr const size_t maxOverlayBlobs = 16;
+		static constexpr const size_t maxVertices = 8 + 16 * (2 * maxOverlayBlobs + 2);
+		static constexpr const size_t maxElements = 12 + 24 * (2 * maxOverlayBlobs + 2);
+		static constexpr const float overlayThickness = 2.0f;
+		static constexpr const double fullUploadRatio = 0.5;
+		static constexpr const int blurBenchmarkIterations = 10;
+		static constexpr const std::chrono::milliseconds startupFrameTimeout =
+			std::chrono::milliseconds(100);
+		static constexpr const std::chrono::milliseconds idleRedrawInterval =
+			std::chrono::milliseconds(250);
+		static constexpr const int inputRedrawFrames = 3;
+		static constexpr const size_t maxSweepResults = 8;
+		static constexpr const int clickRegionSize = 16;
+		static constexpr const double viewRecordingFps = 30.0;
+		static constexpr const std::array<std::array<int, 2>, 4> captureResolutions =
+			{ { { 320, 240 }, { 640, 480 }, { 1280, 720 }, { 1920, 1080 } } };
 	};
 
 }
\ No newline at end of file
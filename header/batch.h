@@ -0,0 +1,66 @@
+#pragma once
+#include "processor.h"
+#include "sweep.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace kop {
+
+	struct BatchOptions {
+	public:
+		std::vector<std::string> inputs = {};
+		std::array<float, 3> lowerHSV = { 0.00f, 0.20f, 0.20f };
+		std::array<float, 3> upperHSV = { 0.15f, 1.00f, 1.00f };
+		std::string outputDirectory = ".";
+		bool writeMask = false;
+		bool writeRle = false;
+		bool writeFiltered = false;
+		bool writeStats = true;
+		bool roiTracking = false;
+		std::string sweepLabelsPath = std::string();
+		std::string graphPath = std::string();
+		size_t numJobs = 0;
+	public:
+		bool loadConfig(const std::string& path);
+		bool parseArgument(const std::string& arg);
+	public:
+		static constexpr const int roiRefreshInterval = 30;
+		static constexpr const size_t maxSweepResults = 20;
+	};
+
+
+	struct BatchResult {
+	public:
+		std::string input = std::string();
+		bool isOpened = false;
+		uint64_t frames = 0;
+		double seconds = 0.0;
+		double roiPixelSavings = 0.0;
+	public:
+		double getFramesPerSecond() const;
+	};
+
+
+	class BatchRunner {
+	public:
+		explicit BatchRunner(const BatchOptions& options);
+		~BatchRunner() = default;
+		int run();
+		const std::vector<BatchResult>& getResults() const;
+	private:
+		void processFile(const std::string& input, BatchResult& result);
+		std::string getOutputPath(
+			const std::string& input, const char* suffix
+		) const;
+		void writeSweep(
+			const std::string& input, ThresholdSweep& sweep
+		) const;
+	private:
+		BatchOptions options;
+		std::vector<BatchResult> results = {};
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+
+namespace kop {
+
+	struct Blob {
+	public:
+		uint64_t area = 0;
+		cv::Rect boundingBox = cv::Rect();
+		cv::Point2d centroid = cv::Point2d();
+		double mu20 = 0.0;
+		double mu11 = 0.0;
+		double mu02 = 0.0;
+	public:
+		double getOrientation() const;
+	};
+
+
+	class BlobExtractor {
+	public:
+		BlobExtractor() = default;
+		~BlobExtractor() = default;
+		void extract(const cv::Mat& mask);
+		void setMinArea(uint64_t area);
+		uint64_t getMinArea() const;
+		const std::vector<Blob>& getBlobs() const;
+	public:
+		static constexpr const int minBandRows = 32;
+	private:
+		struct Run {
+			int y = 0;
+			int begin = 0;
+			int end = 0;
+		};
+		struct Band {
+			std::vector<Run> runs = {};
+			std::vector<int> parents = {};
+			int firstRow = 0;
+			int lastRow = 0;
+			size_t offset = 0;
+		};
+		struct Moments {
+			double m00 = 0.0;
+			double m10 = 0.0;
+			double m01 = 0.0;
+			double m20 = 0.0;
+			double m11 = 0.0;
+			double m02 = 0.0;
+			cv::Rect boundingBox = cv::Rect();
+		};
+	private:
+		void labelBand(const cv::Mat& mask, Band& band) const;
+		void mergeBands(const Band& upper, const Band& lower);
+	private:
+		uint64_t minArea = 64;
+		std::vector<Band> bands = {};
+		std::vector<int> parents = {};
+		std::vector<int> rootBlobs = {};
+		std::vector<Moments> moments = {};
+		std::vector<Blob> blobs = {};
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <array>
+
+
+namespace kop {
+
+	enum class BlurType {
+		Gaussian,
+		Box,
+		Stack,
+		Recursive,
+	};
+
+
+	constexpr const size_t numBlurTypes = 4;
+	constexpr const int boxBlurPasses = 3;
+
+
+	const char* getBlurTypeName(BlurType type);
+	void boxBlur(
+		const cv::Mat& src, cv::Mat& dst, int radius,
+		int passes = boxBlurPasses
+	);
+	void stackBlur(const cv::Mat& src, cv::Mat& dst, int radius);
+	void recursiveGaussianBlur(const cv::Mat& src, cv::Mat& dst, double sigma);
+	void blurImage(
+		const cv::Mat& src, cv::Mat& dst, BlurType type, int radius
+	);
+	std::array<double, numBlurTypes> benchmarkBlur(
+		const cv::Mat& image, int radius, int iterations
+	);
+
+}
\ No newline at end of file
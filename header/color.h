@@ -0,0 +1,41 @@
+#pragma once
+#include "blur.h"
+#include "statistics.h"
+#include <opencv2/core.hpp>
+#include <cstdint>
+
+
+namespace kop {
+
+	enum class PixelFormat {
+		BGR,
+		YUYV,
+		NV12,
+		MJPEG,
+	};
+
+
+	bool isYuvFormat(PixelFormat format);
+	size_t getNativeFrameBytes(PixelFormat format, int width, int height);
+	bool reshapeNativeFrame(
+		const cv::Mat& raw, PixelFormat format,
+		int width, int height, cv::Mat& image
+	);
+	void blurNativeFrame(
+		const cv::Mat& image, PixelFormat format, BlurType type, int radius,
+		cv::Mat& blurred
+	);
+	void convertYuvToRgbaHsv(
+		const cv::Mat& yuv, PixelFormat format, bool flipX, bool flipY,
+		cv::Mat& rgba, cv::Mat& hsv, HsvStatistics* statistics = nullptr
+	);
+	void convertRgbToHsv(
+		const cv::Mat& image, bool isBgr, cv::Mat& hsv,
+		HsvStatistics* statistics = nullptr
+	);
+	uint64_t refineMaskBoundary(
+		const cv::Mat& image, bool isBgr, const cv::Mat& boundary,
+		const cv::Scalar& lower, const cv::Scalar& upper, cv::Mat& mask
+	);
+
+}
\ No newline at end of file
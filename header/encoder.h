@@ -0,0 +1,82 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace kop {
+
+	enum class DropPolicy {
+		DropNewest,
+		DropOldest,
+	};
+
+
+	struct EncoderStats {
+	public:
+		uint64_t submitted = 0;
+		uint64_t encoded = 0;
+		uint64_t dropped = 0;
+		uint64_t duplicated = 0;
+		uint64_t skipped = 0;
+		size_t queued = 0;
+		double encodeMillis = 0.0;
+	};
+
+
+	class FrameEncoder {
+	public:
+		FrameEncoder() = default;
+		~FrameEncoder();
+		FrameEncoder(const FrameEncoder&) = delete;
+		FrameEncoder& operator=(const FrameEncoder&) = delete;
+		bool open(
+			const std::string& path, int width, int height, double fps,
+			size_t queueSize = defaultQueueSize,
+			DropPolicy policy = DropPolicy::DropOldest
+		);
+		void close();
+		bool isOpen() const;
+		bool submit(
+			const void* pixels, size_t step,
+			std::chrono::steady_clock::time_point timestamp
+		);
+		EncoderStats getStats() const;
+	public:
+		static constexpr const size_t defaultQueueSize = 4;
+		static constexpr const double statsSmoothing = 0.1;
+	private:
+		void encoderThread();
+		uint64_t getPacedRepeats(std::chrono::steady_clock::time_point timestamp);
+		void encode(const cv::Mat& frame, uint64_t repeats);
+	private:
+		int width = NULL;
+		int height = NULL;
+		double fps = 0.0;
+		std::chrono::steady_clock::time_point firstTimestamp;
+		uint64_t writtenFrames = 0;
+		bool isRaw = false;
+		cv::VideoWriter writer;
+		std::ofstream rawFile;
+		cv::Mat converted;
+		DropPolicy policy = DropPolicy::DropOldest;
+		std::vector<cv::Mat> slots = {};
+		std::vector<std::chrono::steady_clock::time_point> slotTimes = {};
+		std::vector<size_t> freeSlots = {};
+		std::deque<size_t> queue = {};
+		std::thread worker;
+		mutable std::mutex locker;
+		std::condition_variable queueSignal;
+		bool stopping = false;
+		EncoderStats stats;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+#include "blur.h"
+#include <opencv2/core.hpp>
+#include <array>
+#include <istream>
+#include <string>
+#include <vector>
+
+
+namespace kop {
+
+	enum class StageType {
+		Source,
+		Temporal,
+		Blur,
+		Convert,
+		Threshold,
+		Morphology,
+		Composite,
+		Output,
+	};
+
+
+	struct GraphStage {
+	public:
+		bool isPointwise() const;
+	public:
+		std::string name = std::string();
+		StageType type = StageType::Source;
+		std::vector<int> inputs = {};
+		int outputType = -1;
+		int consumers = 0;
+		int group = -1;
+		int buffer = -1;
+		int lastLevel = -1;
+		float decay = 0.5f;
+		BlurType blurType = BlurType::Gaussian;
+		int radius = 2;
+		int rgbCode = -1;
+		int bgrCode = -1;
+		bool hasRange = false;
+		cv::Scalar lowerBound = cv::Scalar();
+		cv::Scalar upperBound = cv::Scalar(180.0, 255.0, 255.0);
+		int morphology = -1;
+		cv::Mat kernel = cv::Mat();
+		bool isPrimed = false;
+	};
+
+
+	struct GraphGroup {
+	public:
+		std::vector<int> stages = {};
+		int level = 0;
+	};
+
+
+	class ProcessingGraph {
+	public:
+		ProcessingGraph() = default;
+		~ProcessingGraph() = default;
+		ProcessingGraph(const ProcessingGraph&) = delete;
+		ProcessingGraph& operator=(const ProcessingGraph&) = delete;
+		bool load(const std::string& path);
+		bool parse(std::istream& stream);
+		void setRange(const cv::Scalar& lowerBound, const cv::Scalar& upperBound);
+		bool run(const cv::Mat& source, bool isBgr);
+		bool isLoaded() const;
+		bool hasOutput(const std::string& name, int type) const;
+		bool requireOutput(const std::string& name, int type);
+		const cv::Mat& getOutput(const std::string& name) const;
+		const std::string& getError() const;
+		size_t getNumStages() const;
+		size_t getNumGroups() const;
+		size_t getNumLevels() const;
+		size_t getNumBuffers() const;
+		std::string describeSchedule() const;
+	public:
+		static const cv::Scalar nullColor;
+		static constexpr const int numBands = 16;
+	private:
+		bool addStage(
+			const std::string& name, const std::vector<std::string>& tokens
+		);
+		bool setParameter(
+			GraphStage& stage, const std::string& key, const std::string& value
+		);
+		bool compile();
+		void fuseStages();
+		void assignBuffers();
+		void allocateBuffers(const cv::Size& size);
+		void runGroup(const GraphGroup& group, bool isBgr);
+		void runStage(GraphStage& stage);
+		void runStageRow(
+			const GraphStage& stage, const std::array<cv::Mat, 2>& inputs,
+			cv::Mat& output, bool isBgr
+		) const;
+		const cv::Mat& getStageImage(int index) const;
+		cv::Mat getStageRow(int index, int band, int y) const;
+		int findStage(const std::string& name) const;
+		bool fail(const std::string& message);
+	private:
+		std::vector<GraphStage> stages = {};
+		std::vector<GraphGroup> groups = {};
+		std::vector<std::vector<int>> levels = {};
+		std::vector<cv::Mat> buffers = {};
+		std::vector<int> bufferTypes = {};
+		std::vector<cv::Mat> scratch = {};
+		cv::Mat sourceFrame = cv::Mat();
+		cv::Scalar lowerBound = cv::Scalar();
+		cv::Scalar upperBound = cv::Scalar();
+		bool loaded = false;
+		std::string error = std::string();
+	};
+
+}
\ No newline at end of file
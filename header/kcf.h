@@ -0,0 +1,102 @@
+#pragma once
+/*
+ * Headless C interface to the KColorFilter processing core (libkcf).
+ * Frames stay owned by the caller: kcf_process() wraps the buffer without
+ * copying and reads it only for the duration of the call. Results remain
+ * valid until the next kcf_process() or kcf_destroy() on the same handle.
+ * A handle must not be used from several threads at once.
+ * Functions returning int yield 0 on success and -1 on failure, with the
+ * reason available from kcf_last_error().
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(KCF_STATIC)
+#define KCF_API
+#elif defined(KCF_BUILD)
+#define KCF_API __declspec(dllexport)
+#else
+#define KCF_API __declspec(dllimport)
+#endif
+#else
+#define KCF_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KCF_VERSION 1u
+
+typedef struct kcf_processor kcf_processor;
+
+typedef enum kcf_format {
+	KCF_FORMAT_BGR = 0,
+	KCF_FORMAT_RGB = 1,
+	/* Packed 4:2:2, stride >= 2 * width. */
+	KCF_FORMAT_YUYV = 2,
+	/* Luma plane followed by the interleaved chroma plane at the same stride. */
+	KCF_FORMAT_NV12 = 3
+} kcf_format;
+
+typedef struct kcf_frame {
+	const uint8_t* data;
+	int32_t width;
+	int32_t height;
+	int32_t stride;
+	int32_t format;
+} kcf_frame;
+
+typedef struct kcf_image {
+	const uint8_t* data;
+	int32_t width;
+	int32_t height;
+	int32_t stride;
+	int32_t channels;
+} kcf_image;
+
+typedef struct kcf_blob {
+	uint64_t area;
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+	double centroid_x;
+	double centroid_y;
+	double orientation;
+} kcf_blob;
+
+
+KCF_API uint32_t kcf_version(void);
+
+/* Name of the instruction set picked for the hot kernels at load time. */
+KCF_API const char* kcf_cpu_level(void);
+
+KCF_API kcf_processor* kcf_create(void);
+KCF_API void kcf_destroy(kcf_processor* processor);
+
+/* HSV bounds normalized to [0, 1]. */
+KCF_API int kcf_set_range(kcf_processor* processor, const float lower[3], const float upper[3]);
+/* Sizes 0..31; even sizes round up to the next odd kernel. */
+KCF_API int kcf_set_blur(kcf_processor* processor, int32_t type, int32_t size);
+KCF_API int kcf_set_blobs(kcf_processor* processor, int enabled, uint64_t min_area);
+
+/* Loads a processing graph file; NULL or "" restores the built-in pipeline. */
+KCF_API int kcf_load_graph(kcf_processor* processor, const char* path);
+
+KCF_API int kcf_process(kcf_processor* processor, const kcf_frame* frame);
+
+/* 8-bit single channel, 255 inside the range. */
+KCF_API int kcf_get_mask(const kcf_processor* processor, kcf_image* mask);
+/* RGBA, pixels outside the mask cleared to zero. */
+KCF_API int kcf_get_filtered(const kcf_processor* processor, kcf_image* filtered);
+
+/* Copies up to `capacity` blobs and returns the total number found. */
+KCF_API size_t kcf_get_blobs(const kcf_processor* processor, kcf_blob* blobs, size_t capacity);
+
+KCF_API const char* kcf_last_error(const kcf_processor* processor);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
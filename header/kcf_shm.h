@@ -0,0 +1,400 @@
+#pragma once
+/*
+ * Shared-memory frame ring published by KColorFilter (--publish=NAME, with
+ * --publish-packed for a bit-packed mask).
+ * Consumers map the segment with kcf_shm_open(), then either read the newest
+ * frame in place (kcf_shm_begin_read/kcf_shm_end_read) or copy it out
+ * (kcf_shm_read_latest). Each slot is guarded by a seqlock; a reader that is
+ * overtaken by the producer simply retries on the newest frame.
+ * The mask is stored either as bytes or as packed bits (see mask_format); use
+ * kcf_shm_mask_size() and kcf_shm_unpack_mask() rather than assuming a layout.
+ * When the frame size changes the producer supersedes the segment and publishes
+ * a new one under the same name. Once kcf_shm_is_current() returns 0 (or
+ * kcf_shm_wait() returns -1), close the segment and call kcf_shm_open() again
+ * until it succeeds.
+ * POSIX names start with '/', e.g. "/kcolorfilter". Under a strict -std, include
+ * this header before other system headers so the POSIX and futex declarations
+ * it enables are visible.
+ */
+#if !defined(_WIN32) && !defined(_GNU_SOURCE) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KCF_SHM_MAGIC 0x4D48534Bu
+#define KCF_SHM_VERSION 2u
+#define KCF_SHM_MAX_SLOTS 16u
+#define KCF_SHM_ALIGNMENT 64u
+#define KCF_SHM_MASK_BYTES 0u
+#define KCF_SHM_MASK_BITS 1u
+
+typedef struct kcf_shm_slot {
+	volatile uint64_t sequence;
+	uint64_t frame;
+	int64_t timestamp;
+	uint64_t reserved[5];
+} kcf_shm_slot;
+
+typedef struct kcf_shm_header {
+	uint32_t magic;
+	uint32_t version;
+	int32_t width;
+	int32_t height;
+	uint32_t num_slots;
+	volatile uint32_t futex;
+	volatile uint32_t waiters;
+	uint32_t producer;
+	uint64_t mask_offset;
+	uint64_t filtered_offset;
+	uint64_t slot_stride;
+	uint64_t data_offset;
+	volatile uint64_t latest;
+	volatile uint32_t superseded;
+	uint32_t mask_format;
+	uint64_t mask_stride;
+	uint64_t reserved[5];
+	kcf_shm_slot slots[KCF_SHM_MAX_SLOTS];
+} kcf_shm_header;
+
+/*
+ * mask: height rows of mask_stride bytes. KCF_SHM_MASK_BYTES stores one byte per
+ * pixel (0 or 255); KCF_SHM_MASK_BITS stores bit x % 64 of little-endian 64-bit
+ * word x / 64. filtered: width * height RGBA.
+ */
+typedef struct kcf_shm_view {
+	uint64_t frame;
+	int64_t timestamp;
+	const uint8_t* mask;
+	const uint8_t* filtered;
+	uint64_t sequence;
+	uint32_t slot;
+} kcf_shm_view;
+
+
+static inline uint64_t kcf_shm_load_acquire(const volatile uint64_t* value) {
+#if defined(_MSC_VER)
+	const uint64_t result = *value;
+	MemoryBarrier();
+	return result;
+#else
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline uint64_t kcf_shm_load_relaxed(const volatile uint64_t* value) {
+#if defined(_MSC_VER)
+	return *value;
+#else
+	return __atomic_load_n(value, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void kcf_shm_store_release(volatile uint64_t* target, uint64_t value) {
+#if defined(_MSC_VER)
+	MemoryBarrier();
+	*target = value;
+#else
+	__atomic_store_n(target, value, __ATOMIC_RELEASE);
+#endif
+}
+
+static inline void kcf_shm_store_relaxed(volatile uint64_t* target, uint64_t value) {
+#if defined(_MSC_VER)
+	*target = value;
+#else
+	__atomic_store_n(target, value, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void kcf_shm_fence_acquire(void) {
+#if defined(_MSC_VER)
+	MemoryBarrier();
+#else
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void kcf_shm_fence_release(void) {
+#if defined(_MSC_VER)
+	MemoryBarrier();
+#else
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+static inline uint32_t kcf_shm_load32(const volatile uint32_t* value) {
+#if defined(_MSC_VER)
+	return (uint32_t)_InterlockedOr((volatile long*)value, 0);
+#else
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline void kcf_shm_add32(volatile uint32_t* value, int32_t delta) {
+#if defined(_MSC_VER)
+	_InterlockedExchangeAdd((volatile long*)value, delta);
+#else
+	__atomic_add_fetch(value, (uint32_t)delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+
+static inline size_t kcf_shm_size(const kcf_shm_header* header) {
+	return (size_t)(header->data_offset + header->num_slots * header->slot_stride);
+}
+
+static inline const uint8_t* kcf_shm_slot_data(const kcf_shm_header* header, uint32_t slot) {
+	return (const uint8_t*)header + header->data_offset + slot * header->slot_stride;
+}
+
+static inline size_t kcf_shm_mask_size(const kcf_shm_header* header) {
+	return (size_t)header->mask_stride * (size_t)header->height;
+}
+
+
+/* Expands a mask from a view into width * height bytes of 0 or 255. */
+static inline void kcf_shm_unpack_mask(
+	const kcf_shm_header* header, const uint8_t* mask, uint8_t* pixels
+) {
+	int32_t x;
+	int32_t y;
+	if (header->mask_format == KCF_SHM_MASK_BYTES) {
+		for (y = 0; y < header->height; y++) {
+			memcpy(
+				pixels + (size_t)y * header->width, mask + y * header->mask_stride,
+				(size_t)header->width
+			);
+		}
+		return;
+	}
+	for (y = 0; y < header->height; y++) {
+		const uint8_t* row = mask + y * header->mask_stride;
+		uint8_t* out = pixels + (size_t)y * header->width;
+		for (x = 0; x < header->width; x++) {
+			out[x] = ((row[x / 8] >> (x % 8)) & 1u) ? 255 : 0;
+		}
+	}
+}
+
+
+/* Returns 0 once the producer replaced or removed the segment; reopen it by name. */
+static inline int kcf_shm_is_current(const kcf_shm_header* header) {
+	return kcf_shm_load32(&header->superseded) == 0;
+}
+
+
+/* Producer side: wakes consumers blocked in kcf_shm_wait(). */
+static inline void kcf_shm_notify(kcf_shm_header* header) {
+	kcf_shm_add32(&header->futex, 1);
+	if (kcf_shm_load32(&header->waiters) == 0) {
+		return;
+	}
+#if defined(__linux__)
+	syscall(SYS_futex, &header->futex, FUTEX_WAKE, 0x7FFFFFFF, NULL, NULL, 0);
+#endif
+}
+
+
+/*
+ * Blocks until more than `seen` frames were published. Returns 1 on a new frame,
+ * 0 on timeout and -1 once the segment was superseded.
+ */
+static inline int kcf_shm_wait(kcf_shm_header* header, uint64_t seen, int timeout_ms) {
+#if defined(__linux__)
+	struct timespec timeout;
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+	while (kcf_shm_load_acquire(&header->latest) <= seen && kcf_shm_is_current(header)) {
+		kcf_shm_add32(&header->waiters, 1);
+		const uint32_t futex = kcf_shm_load32(&header->futex);
+		if (kcf_shm_load_acquire(&header->latest) > seen || !kcf_shm_is_current(header)) {
+			kcf_shm_add32(&header->waiters, -1);
+			break;
+		}
+		const long status = syscall(
+			SYS_futex, &header->futex, FUTEX_WAIT, futex, &timeout, NULL, 0
+		);
+		kcf_shm_add32(&header->waiters, -1);
+		if (status != 0 && errno == ETIMEDOUT) {
+			break;
+		}
+	}
+#else
+	int elapsed_ms = 0;
+	while (
+		kcf_shm_load_acquire(&header->latest) <= seen && kcf_shm_is_current(header) &&
+		elapsed_ms < timeout_ms
+	) {
+#if defined(_WIN32)
+		Sleep(1);
+#else
+		struct timespec interval = { 0, 1000000L };
+		nanosleep(&interval, NULL);
+#endif
+		elapsed_ms += 1;
+	}
+#endif
+	if (!kcf_shm_is_current(header)) {
+		return -1;
+	}
+	return kcf_shm_load_acquire(&header->latest) > seen;
+}
+
+
+/* Points `view` at the newest frame inside the segment. Returns 0 if nothing was published yet. */
+static inline int kcf_shm_begin_read(const kcf_shm_header* header, kcf_shm_view* view) {
+	for (;;) {
+		const uint64_t latest = kcf_shm_load_acquire(&header->latest);
+		if (latest == 0) {
+			return 0;
+		}
+		const uint32_t slot = (uint32_t)((latest - 1) % header->num_slots);
+		const kcf_shm_slot* state = &header->slots[slot];
+		const uint64_t sequence = kcf_shm_load_acquire(&state->sequence);
+		if (sequence & 1u) {
+			continue;
+		}
+		view->frame = state->frame;
+		view->timestamp = state->timestamp;
+		kcf_shm_fence_acquire();
+		if (kcf_shm_load_relaxed(&state->sequence) != sequence) {
+			continue;
+		}
+		view->mask = kcf_shm_slot_data(header, slot) + header->mask_offset;
+		view->filtered = kcf_shm_slot_data(header, slot) + header->filtered_offset;
+		view->sequence = sequence;
+		view->slot = slot;
+		return 1;
+	}
+}
+
+
+/* Returns 1 if the producer did not touch the slot since kcf_shm_begin_read(). */
+static inline int kcf_shm_end_read(const kcf_shm_header* header, const kcf_shm_view* view) {
+	kcf_shm_fence_acquire();
+	return kcf_shm_load_relaxed(&header->slots[view->slot].sequence) == view->sequence;
+}
+
+
+/*
+ * Copies the newest frame; either buffer may be NULL. `mask` receives
+ * kcf_shm_mask_size() bytes in the segment's mask format. Returns 0 if nothing
+ * was published yet.
+ */
+static inline int kcf_shm_read_latest(
+	const kcf_shm_header* header, uint8_t* mask, uint8_t* filtered, kcf_shm_view* view
+) {
+	const size_t pixels = (size_t)header->width * (size_t)header->height;
+	for (;;) {
+		if (!kcf_shm_begin_read(header, view)) {
+			return 0;
+		}
+		if (mask) {
+			memcpy(mask, view->mask, kcf_shm_mask_size(header));
+		}
+		if (filtered) {
+			memcpy(filtered, view->filtered, pixels * 4);
+		}
+		if (kcf_shm_end_read(header, view)) {
+			return 1;
+		}
+	}
+}
+
+
+static inline kcf_shm_header* kcf_shm_open(const char* name) {
+	kcf_shm_header* header = NULL;
+	size_t size = 0;
+#if defined(_WIN32)
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+	if (!mapping) {
+		return NULL;
+	}
+	header = (kcf_shm_header*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!header) {
+		return NULL;
+	}
+	MEMORY_BASIC_INFORMATION info;
+	if (VirtualQuery(header, &info, sizeof(info)) == 0) {
+		UnmapViewOfFile(header);
+		return NULL;
+	}
+	size = info.RegionSize;
+#else
+	const int file = shm_open(name, O_RDWR, 0);
+	if (file < 0) {
+		return NULL;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0) {
+		close(file);
+		return NULL;
+	}
+	size = (size_t)status.st_size;
+	void* mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+	if (mapped == MAP_FAILED) {
+		return NULL;
+	}
+	header = (kcf_shm_header*)mapped;
+#endif
+	const int is_valid = (
+		size >= sizeof(kcf_shm_header) &&
+		header->magic == KCF_SHM_MAGIC &&
+		header->version == KCF_SHM_VERSION &&
+		header->num_slots > 0 && header->num_slots <= KCF_SHM_MAX_SLOTS &&
+		header->mask_format <= KCF_SHM_MASK_BITS &&
+		kcf_shm_size(header) <= size
+	);
+	if (!is_valid) {
+#if defined(_WIN32)
+		UnmapViewOfFile(header);
+#else
+		munmap(header, size);
+#endif
+		return NULL;
+	}
+	return header;
+}
+
+
+static inline void kcf_shm_close(kcf_shm_header* header) {
+	if (!header) {
+		return;
+	}
+#if defined(_WIN32)
+	UnmapViewOfFile(header);
+#else
+	munmap(header, kcf_shm_size(header));
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
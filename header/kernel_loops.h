@@ -0,0 +1,52 @@
+#pragma once
+#include "kernels.h"
+
+
+namespace {
+
+	void boxColumnStep(
+		const unsigned char* __restrict added, const unsigned char* __restrict removed,
+		int* __restrict sum, unsigned char* __restrict out, int count, int reciprocal
+	) {
+		for (int i = 0; i < count; i++) {
+			out[i] = static_cast<unsigned char>(
+				(sum[i] * reciprocal + kop::fixedHalf) >> kop::fixedShift
+			);
+			sum[i] += added[i] - removed[i];
+		}
+	}
+
+
+	void stackColumnStep(
+		const unsigned char* __restrict next, const unsigned char* __restrict entering,
+		const unsigned char* __restrict leaving, int* __restrict sum,
+		int* __restrict sumIn, int* __restrict sumOut, unsigned char* __restrict out,
+		int count, int reciprocal
+	) {
+		for (int i = 0; i < count; i++) {
+			out[i] = static_cast<unsigned char>(
+				(sum[i] * reciprocal + kop::fixedHalf) >> kop::fixedShift
+			);
+			sum[i] += sumIn[i] - sumOut[i];
+			sumIn[i] += entering[i] - next[i];
+			sumOut[i] += next[i] - leaving[i];
+		}
+	}
+
+
+	void recursiveColumnStep(
+		const float* __restrict w1, const float* __restrict w2,
+		const float* __restrict w3, float* __restrict out,
+		int count, float gain, float a1, float a2, float a3
+	) {
+		for (int i = 0; i < count; i++) {
+			out[i] = gain * out[i] + a1 * w1[i] + a2 * w2[i] + a3 * w3[i];
+		}
+	}
+
+
+	kop::BlurKernels makeBlurKernels() {
+		return { boxColumnStep, stackColumnStep, recursiveColumnStep };
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define KOP_CPU_DISPATCH
+#endif
+
+
+namespace kop {
+
+	enum class CpuLevel {
+		Baseline,
+		Sse41,
+		Avx2,
+		Avx512,
+	};
+
+
+	struct BlurKernels {
+	public:
+		void (*boxColumnStep)(
+			const unsigned char* added, const unsigned char* removed,
+			int* sum, unsigned char* out, int count, int reciprocal
+		) = nullptr;
+		void (*stackColumnStep)(
+			const unsigned char* next, const unsigned char* entering,
+			const unsigned char* leaving, int* sum, int* sumIn, int* sumOut, unsigned char* out,
+			int count, int reciprocal
+		) = nullptr;
+		void (*recursiveColumnStep)(
+			const float* w1, const float* w2, const float* w3, float* out,
+			int count, float gain, float a1, float a2, float a3
+		) = nullptr;
+	};
+
+
+	constexpr const int fixedShift = 16;
+	constexpr const int fixedHalf = 1 << (fixedShift - 1);
+
+
+	CpuLevel detectCpuLevel();
+	const char* getCpuLevelName(CpuLevel level);
+	CpuLevel getCpuLevel();
+	const BlurKernels& getBlurKernels();
+	BlurKernels getBaselineBlurKernels();
+#if defined(KOP_CPU_DISPATCH)
+	BlurKernels getSse41BlurKernels();
+	BlurKernels getAvx2BlurKernels();
+	BlurKernels getAvx512BlurKernels();
+#endif
+
+}
\ No newline at end of file
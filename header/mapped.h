@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace kop {
+
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		bool create(const std::string& path, size_t size);
+		bool open(const std::string& path);
+		bool resize(size_t size);
+		void close();
+		void adviseSequential() const;
+		bool isOpen() const;
+		bool isWritable() const;
+		unsigned char* getData() const;
+		size_t getSize() const;
+	private:
+		bool map();
+		void unmap();
+	private:
+#if defined(_WIN32)
+		void* file = nullptr;
+		void* mapping = nullptr;
+#else
+		int file = -1;
+#endif
+		unsigned char* data = nullptr;
+		size_t size = 0;
+		bool writable = false;
+	};
+
+}
\ No newline at end of file
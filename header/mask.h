@@ -0,0 +1,58 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+
+namespace kop {
+
+	class PackedMask {
+	public:
+		PackedMask() = default;
+		PackedMask(int width, int height);
+		~PackedMask() = default;
+		void create(int width, int height);
+		void pack(const cv::Mat& mask);
+		void unpack(cv::Mat& mask) const;
+		void bitwiseAnd(const PackedMask& other);
+		void bitwiseOr(const PackedMask& other);
+		uint64_t countNonZero() const;
+		cv::Rect getBoundingRect() const;
+		bool empty() const;
+		int getWidth() const;
+		int getHeight() const;
+		size_t getRowWords() const;
+		size_t getNumBytes() const;
+		const uint64_t* row(int y) const;
+		uint64_t* row(int y);
+	private:
+		int width = NULL;
+		int height = NULL;
+		size_t rowWords = 0;
+		std::vector<uint64_t> words = {};
+	};
+
+
+	class RleMask {
+	public:
+		RleMask() = default;
+		~RleMask() = default;
+		void encode(const PackedMask& mask);
+		void decode(PackedMask& mask) const;
+		uint64_t countNonZero() const;
+		cv::Rect getBoundingRect() const;
+		int getWidth() const;
+		int getHeight() const;
+		size_t getNumRuns() const;
+		size_t getNumBytes() const;
+		bool write(std::ostream& stream) const;
+		bool read(std::istream& stream);
+	private:
+		int width = NULL;
+		int height = NULL;
+		std::vector<uint32_t> rowOffsets = {};
+		std::vector<uint32_t> runs = {};
+	};
+
+}
\ No newline at end of file
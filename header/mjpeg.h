@@ -0,0 +1,94 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace kop {
+
+	class MjpegReader {
+	public:
+		MjpegReader() = default;
+		~MjpegReader();
+		bool openCamera(unsigned int cameraId, int width, int height);
+		bool openFile(const std::string& path, double fps = 30.0);
+		bool isOpened() const;
+		void release();
+		bool read(std::vector<unsigned char>& packet, int64_t& timestamp);
+		int getWidth() const;
+		int getHeight() const;
+	private:
+		bool readStreamPacket(std::vector<unsigned char>& packet);
+		bool probeSize(const std::vector<unsigned char>& packet);
+	private:
+		cv::VideoCapture capture;
+		cv::Mat rawPacket;
+		std::ifstream stream;
+		std::vector<unsigned char> streamBuffer;
+		size_t streamOffset = 0;
+		bool isCamera = false;
+		double frameInterval = 0.0;
+		int64_t numPackets = 0;
+		int width = NULL;
+		int height = NULL;
+		std::chrono::steady_clock::time_point startTime;
+	public:
+		static constexpr const size_t streamChunkSize = 1 << 16;
+	};
+
+
+	class MjpegDecoder {
+	public:
+		MjpegDecoder(
+			int width,
+			int height,
+			size_t numWorkers,
+			size_t numBuffers
+		);
+		~MjpegDecoder();
+		bool submit(
+			const unsigned char* data, size_t size,
+			int64_t timestamp, bool wait
+		);
+		bool acquire(cv::Mat& image, int64_t& timestamp, bool wait);
+		void release();
+		size_t getNumWorkers() const;
+	private:
+		enum class SlotState {
+			Free,
+			Queued,
+			Decoded,
+			Failed,
+			Acquired,
+		};
+		struct Slot {
+			std::vector<unsigned char> packet = {};
+			cv::Mat image = cv::Mat();
+			int64_t timestamp = 0;
+			SlotState state = SlotState::Free;
+		};
+	private:
+		void workerThread();
+	private:
+		int width = NULL;
+		int height = NULL;
+		std::vector<Slot> slots;
+		std::vector<std::thread> workers;
+		std::deque<size_t> jobs;
+		mutable std::mutex locker;
+		std::condition_variable jobSignal;
+		std::condition_variable slotSignal;
+		uint64_t submitSequence = 0;
+		uint64_t acquireSequence = 0;
+		bool stopping = false;
+	};
+
+}
\ No newline at end of file
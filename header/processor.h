@@ -0,0 +1,128 @@
+#pragma once
+#include "allocator.h"
+#include "blob.h"
+#include "blur.h"
+#include "color.h"
+#include "graph.h"
+#include "roi.h"
+#include "statistics.h"
+#include "tiles.h"
+#include <opencv2/core.hpp>
+#include <array>
+#include <cstdint>
+
+
+namespace kop {
+
+	struct PyramidStats {
+	public:
+		double getSpeedup() const;
+	public:
+		uint64_t frames = 0;
+		uint64_t refinedPixels = 0;
+		double accuracy = 1.0;
+		double pyramidMillis = 0.0;
+		double referenceMillis = 0.0;
+	};
+
+
+	class Processor {
+	public:
+		Processor();
+		~Processor() = default;
+		Processor(const Processor&) = delete;
+		Processor& operator=(const Processor&) = delete;
+		void setRange(
+			const std::array<float, 3>& lowerHSV,
+			const std::array<float, 3>& upperHSV
+		);
+		void setBlobOptions(bool enabled, uint64_t minArea);
+		void setTileTracking(bool enabled);
+		void setRoiTracking(bool enabled, int refreshInterval);
+		void setPyramidLevel(int level);
+		void setBlurSize(int size);
+		void setBlurType(BlurType type);
+		void setStatistics(bool enabled, const cv::Rect& region, float decay);
+		bool setGraph(ProcessingGraph* graph);
+		bool reserveArena(
+			size_t frameBytes, bool hugePages = false,
+			int numaNode = anyNumaNode
+		);
+		bool processRgb(const cv::Mat& rgb, bool flip);
+		bool processBgr(const cv::Mat& bgr);
+		bool processNative(const cv::Mat& yuv, PixelFormat format, bool flip);
+		const cv::Mat& getOriginalFrame() const;
+		const cv::Mat& getFilteredFrame() const;
+		const cv::Mat& getHsvImage() const;
+		const cv::Mat& getMask() const;
+		const std::vector<Blob>& getBlobs() const;
+		const cv::Rect& getProcessedRoi() const;
+		const RoiTracker& getRoiTracker() const;
+		int getPyramidLevel() const;
+		int getBlurSize() const;
+		BlurType getBlurType() const;
+		const PyramidStats& getPyramidStats() const;
+		const HsvStatistics& getStatistics() const;
+		const DirtyTiles& getOriginalTiles() const;
+		const DirtyTiles& getFilteredTiles() const;
+		const FrameArena& getArena() const;
+	public:
+		static const cv::Scalar nullColor;
+		static constexpr const size_t arenaFramesPerCapacity = 16;
+		static constexpr const int maxPyramidLevel = 2;
+		static constexpr const int defaultBlurSize = 5;
+		static constexpr const int maxBlurSize = 31;
+		static constexpr const uint64_t pyramidReferenceInterval = 30;
+	private:
+		std::array<cv::Mat*, 10> getFrameImages();
+		void beginFrame();
+		cv::Mat blurFrame(const cv::Mat& image, cv::Mat& blurred, int size) const;
+		cv::Mat blurWindow(const cv::Mat& image, const cv::Rect& roi);
+		void processColorFrame(
+			const cv::Mat& image, int rgbaCode, int hsvCode
+		);
+		void convertColorFrame(
+			const cv::Mat& image, int rgbaCode, int hsvCode
+		);
+		void processGraph(const cv::Mat& image, bool isBgr);
+		void convertHsv(
+			const cv::Mat& image, int hsvCode, const cv::Point& origin, int scale
+		);
+		void threshold();
+		void thresholdPyramid(
+			const cv::Mat& image, int rgbaCode, int hsvCode
+		);
+		void measurePyramidAccuracy(
+			const cv::Mat& blurred, int hsvCode, double blurMillis
+		);
+		void composite();
+	private:
+		cv::Scalar lowerBound = cv::Scalar();
+		cv::Scalar upperBound = cv::Scalar();
+		FrameArena arena;
+		BlobExtractor blobExtractor;
+		bool blobsEnabled = true;
+		RoiTracker roiTracker;
+		cv::Rect processedRoi = cv::Rect();
+		int pyramidLevel = 0;
+		int blurSize = defaultBlurSize;
+		BlurType blurType = BlurType::Gaussian;
+		PyramidStats pyramidStats;
+		HsvStatistics statistics;
+		ProcessingGraph* graph = nullptr;
+		DirtyTiles originalTiles;
+		DirtyTiles filteredTiles;
+		bool tilesEnabled = false;
+		cv::Mat rgbFrame;
+		cv::Mat blurredFrame;
+		cv::Mat hsvImage;
+		cv::Mat hsvMask;
+		cv::Mat originalFrame;
+		cv::Mat filteredFrame;
+		cv::Mat levelFrame;
+		cv::Mat levelMask;
+		cv::Mat levelBoundary;
+		cv::Mat boundaryMask;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+#include "mask.h"
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+
+struct kcf_shm_header;
+
+
+namespace kop {
+
+	class FramePublisher {
+	public:
+		FramePublisher() = default;
+		~FramePublisher();
+		FramePublisher(const FramePublisher&) = delete;
+		FramePublisher& operator=(const FramePublisher&) = delete;
+		bool create(
+			const std::string& name, int width, int height,
+			bool packedMask = false,
+			size_t numSlots = FramePublisher::defaultSlots
+		);
+		void destroy();
+		bool isCreated() const;
+		bool publish(
+			const cv::Mat& mask, const cv::Mat& filtered, int64_t timestamp
+		);
+		uint64_t getPublishedFrames() const;
+		const std::string& getName() const;
+	public:
+		static constexpr const size_t defaultSlots = 4;
+	private:
+		std::string name = std::string();
+#if defined(_WIN32)
+		void* mappingHandle = nullptr;
+#endif
+		kcf_shm_header* header = nullptr;
+		size_t memorySize = 0;
+		uint64_t numFrames = 0;
+		PackedMask packedMask;
+	};
+
+}
\ No newline at end of file
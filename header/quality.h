@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace kop {
+
+	struct QualitySettings {
+	public:
+		int mafOrder = 1;
+		int blurSize = 5;
+		int pyramidLevel = 0;
+		int frameSkip = 1;
+	public:
+		bool operator==(const QualitySettings& other) const;
+		bool operator!=(const QualitySettings& other) const;
+		std::string toString() const;
+	};
+
+
+	class QualityController {
+	public:
+		QualityController();
+		~QualityController() = default;
+		void setEnabled(bool enabled);
+		bool isEnabled() const;
+		void setTargetMillis(double millis);
+		double getTargetMillis() const;
+		void setBaseline(const QualitySettings& settings);
+		void setPyramidSupported(bool supported);
+		bool update(double frameMillis);
+		double getAverageMillis() const;
+		size_t getLevel() const;
+		size_t getNumLevels() const;
+		uint64_t getTransitions() const;
+		const QualitySettings& getSettings() const;
+	public:
+		static constexpr const double defaultTargetMillis = 1000.0 / 60.0;
+		static constexpr const double degradeRatio = 1.0;
+		static constexpr const double restoreRatio = 0.6;
+		static constexpr const double smoothing = 0.1;
+		static constexpr const uint64_t degradeDwellFrames = 15;
+		static constexpr const uint64_t restoreDwellFrames = 90;
+		static constexpr const uint64_t maxRestoreDwellFrames = 1440;
+		static constexpr const int minBlurSize = 3;
+		static constexpr const int maxPyramidLevel = 2;
+		static constexpr const int maxFrameSkip = 3;
+	private:
+		void rebuildLevels();
+		void setLevel(size_t level, const char* transition);
+	private:
+		bool enabled = false;
+		double targetMillis = defaultTargetMillis;
+		double averageMillis = 0.0;
+		QualitySettings baseline;
+		bool pyramidSupported = true;
+		std::vector<QualitySettings> levels;
+		size_t level = 0;
+		uint64_t framesSinceTransition = 0;
+		uint64_t restoreDwell = restoreDwellFrames;
+		bool lastWasRestore = false;
+		uint64_t transitions = 0;
+	};
+
+}
\ No newline at end of file
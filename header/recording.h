@@ -0,0 +1,86 @@
+#pragma once
+#include "color.h"
+#include "mapped.h"
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace kop {
+
+	constexpr const uint32_t recordingMagic = 0x5741524B;
+	constexpr const uint32_t recordingVersion = 1;
+	constexpr const uint64_t recordingAlignment = 4096;
+	constexpr const uint64_t recordingFramePrefix = 64;
+
+
+	struct RecordingHeader {
+	public:
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		int32_t width = 0;
+		int32_t height = 0;
+		int32_t format = 0;
+		uint32_t reserved = 0;
+		uint64_t frameBytes = 0;
+		uint64_t frameStride = 0;
+		uint64_t numFrames = 0;
+		uint64_t indexOffset = 0;
+		uint64_t padding = 0;
+	};
+
+
+	struct RecordingIndexEntry {
+	public:
+		uint64_t offset = 0;
+		int64_t timestamp = 0;
+	};
+
+
+	class FrameRecorder {
+	public:
+		FrameRecorder() = default;
+		~FrameRecorder();
+		bool open(
+			const std::string& path, int width, int height, PixelFormat format
+		);
+		bool append(const cv::Mat& frame, int64_t timestamp);
+		void close();
+		bool isOpen() const;
+		uint64_t getNumFrames() const;
+	public:
+		static constexpr const uint64_t growFrames = 64;
+	private:
+		bool reserve(uint64_t numFrames);
+		RecordingHeader* getHeader() const;
+	private:
+		MappedFile file;
+		uint64_t frameBytes = 0;
+		uint64_t frameStride = 0;
+		uint64_t capacity = 0;
+		std::vector<RecordingIndexEntry> index = {};
+	};
+
+
+	class FrameReplayer {
+	public:
+		FrameReplayer() = default;
+		~FrameReplayer() = default;
+		bool open(const std::string& path);
+		void close();
+		bool isOpen() const;
+		int getWidth() const;
+		int getHeight() const;
+		PixelFormat getFormat() const;
+		uint64_t getNumFrames() const;
+		bool readFrame(uint64_t frame, cv::Mat& image, int64_t& timestamp) const;
+	public:
+		static bool isRecording(const std::string& path);
+	private:
+		MappedFile file;
+		RecordingHeader header;
+		std::vector<RecordingIndexEntry> index = {};
+	};
+
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include "encoder.h"
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <opencv2/core.hpp>
@@ -25,6 +26,30 @@ namespace kop {
 	};
 
 
+	enum class TemporalMode {
+		Off,
+		Mean,
+		Exponential,
+	};
+
+
+	struct TemporalFilter {
+	public:
+		TemporalMode mode = TemporalMode::Off;
+		int depth = 1;
+		float decay = 0.5f;
+	};
+
+
+	struct RecordingStats {
+	public:
+		uint64_t captured = 0;
+		uint64_t readbackDrops = 0;
+		double captureMillis = 0.0;
+		EncoderStats encoder;
+	};
+
+
 	class Entity {
 	public:
 		Entity() = default;
@@ -78,17 +103,34 @@ namespace kop {
 		virtual void clear() = 0;
 		virtual bool add(const Object& obj) = 0;
 		virtual bool updateTexture(const void* data, size_t index) = 0;
+		virtual bool updateTextureRegions(
+			const void* data, size_t index,
+			const std::vector<cv::Rect>& regions
+		);
+		virtual bool pushHistoryFrame(const void* data);
+		virtual bool resizeTextures(int width, int height);
+		virtual bool canResizeTextures() const;
+		void setTemporalFilter(const TemporalFilter& filter);
+		const TemporalFilter& getTemporalFilter() const;
+		size_t getHistoryCount() const;
+		uint64_t getUploadedBytes() const;
+		virtual bool startRecording(const std::string& path, double fps);
+		virtual void stopRecording();
+		virtual bool isRecording() const;
+		virtual RecordingStats getRecordingStats() const;
 		virtual void render() = 0;
 		virtual void present() = 0;
 	public:
 		static constexpr const size_t maxTextures = 2;
+		static constexpr const size_t maxHistoryLayers = 8;
+		static constexpr const size_t historyTarget = 0;
 	public:
 		const char* vertexShaderPath;
 		const char* fragmentShaderPath;
 		const size_t maxVertices;
 		const size_t maxElements;
-		const int textureWidth;
-		const int textureHeight;
+		int textureWidth;
+		int textureHeight;
 	protected:
 		virtual void createWindow() = 0;
 		virtual void createShaderProgram() = 0;
@@ -100,6 +142,10 @@ namespace kop {
 		int windowHeight = 600;
 		size_t vertexOffset = 0;
 		size_t elementOffset = 0;
+		uint64_t uploadedBytes = 0;
+		TemporalFilter temporalFilter;
+		size_t historyHead = 0;
+		size_t historyCount = 0;
 		ImGuiContext* imgui = nullptr;
 	private:
 		static size_t numInstances;
@@ -22,20 +22,50 @@ namespace kop {
 		void clear() override;
 		bool add(const Object& obj) override;
 		bool updateTexture(const void* data, size_t index) override;
+		bool updateTextureRegions(
+			const void* data, size_t index,
+			const std::vector<cv::Rect>& regions
+		) override;
+		bool pushHistoryFrame(const void* data) override;
+		bool resizeTextures(int width, int height) override;
+		bool canResizeTextures() const override;
+		bool startRecording(const std::string& path, double fps) override;
+		void stopRecording() override;
+		bool isRecording() const override;
+		RecordingStats getRecordingStats() const override;
 		void render() override;
 		void present() override;
+	public:
+		static constexpr const size_t readbackSlots = 3;
+		static constexpr const uint64_t readbackStopTimeout = 100000000;
 	private:
 		void createWindow() override;
 		void createShaderProgram() override;
 		void createVertexArray();
 		void createVertexBuffers() override;
 		void createTextures() override;
+		void updateTemporalUniforms();
+		void captureFrame();
+		bool collectReadback(size_t slot, uint64_t timeout);
 	private:
 		unsigned int shader = NULL;
 		unsigned int vao = NULL;
 		unsigned int vbo = NULL;
 		unsigned int ebo = NULL;
 		unsigned int tex = NULL;
+		unsigned int retiredTex = NULL;
+		int temporalModeLocation = -1;
+		int temporalDepthLocation = -1;
+		int temporalDecayLocation = -1;
+		int historyHeadLocation = -1;
+		std::array<unsigned int, readbackSlots> readbackBuffers = {};
+		std::array<GLsync, readbackSlots> readbackFences = {};
+		std::array<std::chrono::steady_clock::time_point, readbackSlots> readbackTimes = {};
+		size_t readbackHead = 0;
+		int readbackWidth = NULL;
+		int readbackHeight = NULL;
+		FrameEncoder encoder;
+		RecordingStats recordingStats;
 	private:
 		static size_t numInstance;
 	private:
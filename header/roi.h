@@ -0,0 +1,48 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstdint>
+
+
+namespace kop {
+
+	struct RoiStats {
+	public:
+		uint64_t frames = 0;
+		uint64_t roiFrames = 0;
+		uint64_t hits = 0;
+		uint64_t losses = 0;
+		uint64_t processedPixels = 0;
+		uint64_t totalPixels = 0;
+	public:
+		double getHitRate() const;
+		double getPixelSavings() const;
+	};
+
+
+	class RoiTracker {
+	public:
+		RoiTracker() = default;
+		~RoiTracker() = default;
+		void setEnabled(bool enabled);
+		bool isEnabled() const;
+		void setRefreshInterval(int frames);
+		int getRefreshInterval() const;
+		cv::Rect predict(const cv::Size& frameSize);
+		void update(const cv::Rect& roi, const cv::Rect& detection);
+		void reset();
+		const cv::Rect& getLastDetection() const;
+		const RoiStats& getStats() const;
+	public:
+		static constexpr const int minMargin = 16;
+		static constexpr const float marginScale = 0.25f;
+	private:
+		bool enabled = false;
+		int refreshInterval = 30;
+		int framesSinceFull = 0;
+		cv::Size frameSize = cv::Size();
+		cv::Rect lastDetection = cv::Rect();
+		cv::Point motion = cv::Point();
+		RoiStats stats;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+namespace kop {
+
+	class HsvStatistics {
+	public:
+		HsvStatistics();
+		~HsvStatistics() = default;
+		void setEnabled(bool enabled);
+		bool isEnabled() const;
+		void setRegion(const cv::Rect& region);
+		const cv::Rect& getRegion() const;
+		void setDecay(float decay);
+		void reset();
+		void beginFrame(const cv::Point& origin, int scale);
+		void accumulateRow(int band, int y, const uchar* hsvRow, int width);
+		void endFrame();
+		bool calibrate(
+			float coverage,
+			std::array<float, 3>& lowerHSV, std::array<float, 3>& upperHSV
+		) const;
+		double getFrameTotal() const;
+		double getRegionTotal() const;
+		const std::vector<float>& getFrameHistogram() const;
+		const std::vector<float>& getRegionHistogram() const;
+	public:
+		static constexpr const std::array<int, 3> binSizes = { 4, 16, 16 };
+		static constexpr const std::array<int, 3> numBins = { 45, 16, 16 };
+		static constexpr const size_t numCells = 45 * 16 * 16;
+		static constexpr const int numBands = 8;
+		static constexpr const float defaultDecay = 0.9f;
+	private:
+		static size_t getCell(const uchar* hsv);
+	private:
+		bool enabled = false;
+		cv::Rect region = cv::Rect();
+		float decay = defaultDecay;
+		cv::Point origin = cv::Point();
+		int scale = 1;
+		std::vector<uint32_t> bandCounts;
+		std::vector<float> frameHistogram;
+		std::vector<float> regionHistogram;
+		double frameTotal = 0.0;
+		double regionTotal = 0.0;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+namespace kop {
+
+	struct HsvRange {
+	public:
+		std::array<int, 3> lower = { 0, 0, 0 };
+		std::array<int, 3> upper = { 179, 255, 255 };
+	public:
+		static HsvRange fromNormalized(
+			const std::array<float, 3>& lowerHSV,
+			const std::array<float, 3>& upperHSV
+		);
+		void toNormalized(
+			std::array<float, 3>& lowerHSV, std::array<float, 3>& upperHSV
+		) const;
+	};
+
+
+	struct SweepResult {
+	public:
+		HsvRange range = HsvRange();
+		uint64_t pixels = 0;
+		uint64_t truePositives = 0;
+		double precision = 0.0;
+		double recall = 0.0;
+		double score = 0.0;
+	};
+
+
+	class HsvHistogram {
+	public:
+		HsvHistogram();
+		~HsvHistogram() = default;
+		void reset();
+		void accumulate(const cv::Mat& hsv, const cv::Mat& mask = cv::Mat());
+		void buildSummedTable();
+		uint64_t getCount(const HsvRange& range) const;
+		uint64_t getTotal() const;
+	public:
+		static constexpr const std::array<int, 3> binSizes = { 2, 4, 4 };
+		static constexpr const std::array<int, 3> numBins = { 90, 64, 64 };
+		static constexpr const size_t numCells = 90 * 64 * 64;
+	private:
+		static size_t getIndex(int h, int s, int v);
+	private:
+		std::vector<uint64_t> counts;
+		std::vector<uint64_t> table;
+		uint64_t total = 0;
+	};
+
+
+	class ThresholdSweep {
+	public:
+		ThresholdSweep() = default;
+		~ThresholdSweep() = default;
+		void reset();
+		void accumulate(const cv::Mat& hsv, const cv::Mat& labels);
+		std::vector<SweepResult> evaluate(
+			const std::vector<HsvRange>& candidates, size_t maxResults
+		);
+		uint64_t getFrames() const;
+		bool hasLabels() const;
+	public:
+		static std::vector<HsvRange> generateCandidates(
+			const HsvRange& center, int steps = defaultSteps,
+			int stride = defaultStride
+		);
+	public:
+		static constexpr const int defaultSteps = 2;
+		static constexpr const int defaultStride = 2;
+		static constexpr const double recallWeight = 1.0;
+	private:
+		HsvHistogram frameHistogram;
+		HsvHistogram labelHistogram;
+		uint64_t frames = 0;
+		bool isLabelled = false;
+		bool isDirty = false;
+	};
+
+}
\ No newline at end of file
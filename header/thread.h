@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+
+namespace kop {
+
+	struct ThreadOptions {
+	public:
+		uint64_t affinityMask = 0;
+		int realtimePriority = 0;
+	};
+
+
+	bool applyThreadOptions(const ThreadOptions& options);
+	bool parseCpuList(const std::string& cpuList, uint64_t& mask);
+	double getProcessCpuSeconds();
+
+}
\ No newline at end of file
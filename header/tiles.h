@@ -0,0 +1,31 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+
+namespace kop {
+
+	class DirtyTiles {
+	public:
+		DirtyTiles();
+		~DirtyTiles() = default;
+		void reset();
+		void update(const cv::Mat& frame);
+		bool isDirty(int tileX, int tileY) const;
+		size_t getNumDirty() const;
+		size_t getNumTiles() const;
+		double getDirtyRatio() const;
+		const std::vector<cv::Rect>& getDirtyRects() const;
+	public:
+		static constexpr const int tileSize = 64;
+	private:
+		cv::Mat previous = cv::Mat();
+		int tilesX = NULL;
+		int tilesY = NULL;
+		std::vector<uint8_t> dirty = {};
+		std::vector<cv::Rect> dirtyRects = {};
+		size_t numDirty = 0;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#pragma once
+#include "allocator.h"
+#include "color.h"
+#include "mjpeg.h"
+#include "recording.h"
+#include "thread.h"
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+namespace kop {
+
+	struct CaptureMode {
+	public:
+		int width = NULL;
+		int height = NULL;
+		PixelFormat format = PixelFormat::BGR;
+	};
+
+
+	struct CaptureStats {
+	public:
+		uint64_t frames = 0;
+		uint64_t droppedFrames = 0;
+		uint64_t fallbackCopies = 0;
+		uint64_t steadyAllocations = 0;
+		uint64_t modeSwitches = 0;
+		uint64_t failedSwitches = 0;
+		double switchMillis = 0.0;
+		bool captureLost = false;
+	};
+
+
+	class Webcam {
+	public:
+		using FrameListener = void (*)();
+	public:
+		Webcam(
+			unsigned int cameraId,
+			int width,
+			int height,
+			PixelFormat format = PixelFormat::BGR
+		);
+		Webcam(const std::string& sourcePath, double fps = 30.0);
+		~Webcam();
+		bool isActive() const;
+		void setActive(bool newState);
+		int getWidth() const;
+		int getHeight() const;
+		PixelFormat getFormat() const;
+		CaptureMode getMode() const;
+		bool requestMode(const CaptureMode& mode);
+		bool isSwitchingMode() const;
+		void getFrame(cv::Mat& image) const;
+		int acquireFrame() const;
+		const cv::Mat& readFrame(int handle) const;
+		const CaptureMode& getFrameMode(int handle) const;
+		void releaseFrame(int handle) const;
+		int64_t getFrameTimestamp() const;
+		uint64_t getFrameSequence() const;
+		uint64_t getNotifiedSequence() const;
+		bool waitFrame(
+			uint64_t lastSequence, std::chrono::milliseconds timeout
+		) const;
+		CaptureStats getCaptureStats() const;
+		void setHugePages(bool enabled);
+		void setThreadOptions(const ThreadOptions& options);
+		void setReplayPacing(bool paced);
+		bool startRecording(const std::string& path);
+		void stopRecording();
+		bool isRecording() const;
+		uint64_t getRecordedFrames() const;
+		void openSettings();
+		void setMafOrder(size_t order);
+		void setFrameListener(FrameListener listener);
+	public:
+		static constexpr const size_t maxMafOrder = 5;
+		static constexpr const size_t numFramePools = 2;
+		static constexpr const std::chrono::milliseconds poolDrainTimeout =
+			std::chrono::milliseconds(100);
+		static const cv::Scalar nullColor;
+	private:
+		bool openCamera();
+		bool configureCamera();
+		void closeCamera();
+		bool allocateBuffers();
+		bool reclaimPool(size_t pool);
+		bool applyPendingMode();
+		bool switchMode(const CaptureMode& mode);
+		void streamingThread();
+		void threadLoop();
+		void cameraLoop();
+		void mjpegLoop();
+		void replayLoop();
+		bool drainDecoder(MjpegDecoder& decoder, bool wait);
+		void commitFrame(int64_t timestamp);
+	private:
+		unsigned int cameraId = NULL;
+		std::atomic<int> width = 0;
+		std::atomic<int> height = 0;
+		std::atomic<PixelFormat> format = PixelFormat::BGR;
+		mutable std::mutex modeLocker;
+		CaptureMode pendingMode;
+		std::atomic<bool> modePending = false;
+		std::atomic<bool> modeSwitching = false;
+		std::chrono::steady_clock::time_point switchStart;
+		std::atomic<uint64_t> numModeSwitches = 0;
+		std::atomic<uint64_t> numFailedSwitches = 0;
+		std::atomic<double> switchMillis = 0.0;
+		std::atomic<bool> captureLost = false;
+		std::string sourcePath = std::string();
+		double sourceFps = 30.0;
+		cv::VideoCapture camera;
+		MjpegReader mjpegReader;
+		bool isReplay = false;
+		bool replayPaced = true;
+		FrameReplayer replayer;
+		mutable std::mutex recordLocker;
+		FrameRecorder recorder;
+		mutable std::mutex activeLocker;
+		std::thread streamer;
+		std::atomic<bool> stateActive = false;
+		std::atomic<bool> stopRequested = false;
+		ThreadOptions threadOptions;
+		mutable std::mutex frameLocker;
+		mutable std::condition_variable frameSignal;
+		int latestHandle = FramePool::nullHandle;
+		int64_t frameTimestamp = 0;
+		std::atomic<FrameListener> frameListener = nullptr;
+		std::atomic<uint64_t> notifiedSequence = 0;
+		bool hugePages = false;
+		FramePool capturePool;
+		mutable std::array<FramePool, numFramePools> framePools;
+		std::array<CaptureMode, numFramePools> poolModes = {};
+		size_t activePool = 0;
+		std::array<cv::Mat, maxMafOrder + 1> captureHeaders = {};
+		std::array<cv::Mat, maxMafOrder + 1> mafHeaders = {};
+		std::atomic<uint64_t> numFrames = 0;
+		std::atomic<uint64_t> numDroppedFrames = 0;
+		std::atomic<uint64_t> numFallbackCopies = 0;
+		std::atomic<uint64_t> numSteadyAllocations = 0;
+		uint64_t steadyAllocationBase = 0;
+		std::atomic<size_t> mafOrder = 1;
+		std::array<cv::Mat, maxMafOrder> mafBuffer = {};
+		cv::Mat mafFrame = cv::Mat();
+		size_t mafIter = 0;
+	public:
+		static constexpr const size_t numPublishBuffers = 4;
+	private:
+		static bool movingAverageFilter(
+			size_t order, cv::Mat& image,
+			std::array<cv::Mat, maxMafOrder>& buffer
+		);
+	};
+
+}
\ No newline at end of file
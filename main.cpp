@@ -1,5 +1,7 @@
 #define __KOP_BACKEND_OPENGL__
 
+#include <iostream>
+#include <stdexcept>
 #include <string>
 
 #ifdef NDEBUG
@@ -26,17 +28,161 @@ const char* FRAGMENT_SHADER_NAME = "directx12.frag";
 #endif
 
 #include "application.h"
+#include "batch.h"
 
 
-int main() {
+kop::PixelFormat parseCaptureFormat(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--yuyv") {
+			return kop::PixelFormat::YUYV;
+		}
+		if (arg == "--nv12") {
+			return kop::PixelFormat::NV12;
+		}
+		if (arg == "--mjpeg") {
+			return kop::PixelFormat::MJPEG;
+		}
+	}
+	return kop::PixelFormat::BGR;
+}
+
+
+bool hasFlag(int argc, char** argv, const char* flag) {
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == flag) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+std::string getOption(int argc, char** argv, const std::string& prefix) {
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg.compare(0, prefix.size(), prefix) == 0) {
+			return arg.substr(prefix.size());
+		}
+	}
+	return std::string();
+}
+
+
+bool parseInteger(const std::string& text, int& number) {
+	try {
+		size_t length = 0;
+		number = std::stoi(text, &length);
+		return length == text.size();
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+}
+
+
+bool parseNumaNode(int argc, char** argv, int& node) {
+	const std::string value = getOption(argc, argv, "--arena-numa=");
+	if (value.empty()) {
+		node = kop::anyNumaNode;
+		return true;
+	}
+	if (value == "local") {
+		node = kop::localNumaNode;
+		return true;
+	}
+	if (!parseInteger(value, node) || node < 0) {
+		std::cerr << "Usage: --arena-numa=<node>|local, got " << value << '.' << std::endl;
+		return false;
+	}
+	return true;
+}
+
+
+bool parseCaptureThreadOptions(
+	int argc, char** argv, kop::ThreadOptions& options
+) {
+	const std::string cpus = getOption(argc, argv, "--capture-cpus=");
+	const std::string priority = getOption(argc, argv, "--capture-priority=");
+	if (!cpus.empty() && !kop::parseCpuList(cpus, options.affinityMask)) {
+		std::cerr << "Usage: --capture-cpus=<cpu>[-<cpu>][,...], got " << cpus << '.' << std::endl;
+		return false;
+	}
+	if (
+		!priority.empty() &&
+		(!parseInteger(priority, options.realtimePriority) || options.realtimePriority < 0)
+	) {
+		std::cerr << "Usage: --capture-priority=<priority>, got " << priority << '.' << std::endl;
+		return false;
+	}
+	return true;
+}
+
+
+int runBatch(int argc, char** argv) {
+	kop::BatchOptions options;
+	for (int i = 1; i < argc; i++) {
+		if (!options.parseArgument(argv[i])) {
+			std::cerr << "Batch: Invalid argument " << argv[i] << '.' << std::endl;
+			return 1;
+		}
+	}
+	kop::BatchRunner runner(options);
+	return runner.run();
+}
+
+
+int main(int argc, char** argv) {
+	kop::CountingAllocator::install();
+	if (hasFlag(argc, argv, "--batch")) {
+		return runBatch(argc, argv);
+	}
+	kop::ThreadOptions captureThreadOptions;
+	int arenaNumaNode = kop::anyNumaNode;
+	if (
+		!parseCaptureThreadOptions(argc, argv, captureThreadOptions) ||
+		!parseNumaNode(argc, argv, arenaNumaNode)
+	) {
+		return 1;
+	}
 	const std::string vertexShaderPath = SHADER_ROOT + VERTEX_SHADER_NAME;
 	const std::string fragmentSahderPath = SHADER_ROOT + FRAGMENT_SHADER_NAME;
-	kop::Webcam webcam(0, 720, 480);
+	const std::string sourcePath = getOption(argc, argv, "--source=");
+	kop::Webcam webcam = sourcePath.empty()
+		? kop::Webcam(0, 720, 480, parseCaptureFormat(argc, argv))
+		: kop::Webcam(sourcePath);
+	webcam.setHugePages(hasFlag(argc, argv, "--hugepages"));
+	webcam.setThreadOptions(captureThreadOptions);
+	webcam.setReplayPacing(!hasFlag(argc, argv, "--replay-fast"));
+	const std::string recordingPath = getOption(argc, argv, "--record=");
+	if (!recordingPath.empty()) {
+		webcam.startRecording(recordingPath);
+	}
 	kop::__KOP_BACKEND_TYPE__ renderer(
 		vertexShaderPath.c_str(), fragmentSahderPath.c_str(),
-		12, 12, webcam.getWidth(), webcam.getHeight()
+		kop::Application::maxVertices, kop::Application::maxElements,
+		webcam.getWidth(), webcam.getHeight()
 	);
 	kop::Application app(webcam, renderer);
+	app.setArenaOptions(hasFlag(argc, argv, "--arena-hugepages"), arenaNumaNode);
+	if (!recordingPath.empty()) {
+		app.setRecordingPath(recordingPath);
+	}
+	app.setPublishName(
+		getOption(argc, argv, "--publish="), hasFlag(argc, argv, "--publish-packed")
+	);
+	const std::string viewRecordingPath = getOption(argc, argv, "--record-view=");
+	if (!viewRecordingPath.empty()) {
+		app.setViewRecordingPath(viewRecordingPath, true);
+	}
+	const std::string labelsPath = getOption(argc, argv, "--labels=");
+	if (!labelsPath.empty() && !app.loadSweepLabels(labelsPath)) {
+		std::cerr << "Sweep: Cannot load labels from " << labelsPath << '.' << std::endl;
+	}
+	const std::string graphPath = getOption(argc, argv, "--graph=");
+	if (!graphPath.empty() && !app.loadGraph(graphPath)) {
+		std::cerr << "Graph: " << app.getGraphError() << '.' << std::endl;
+	}
 	app.run();
 	return 0;
 }
\ No newline at end of file
@@ -2,6 +2,13 @@
 
 
 uniform sampler2DArray textures;
+uniform int temporalMode;
+uniform int temporalDepth;
+uniform float temporalDecay;
+uniform int historyHead;
+uniform int historyBase;
+uniform int historySize;
+uniform int historyTarget;
 
 
 in vec3 vertTexCoord;
@@ -11,10 +18,29 @@ in vec4 vertColor;
 out vec4 fragColor;
 
 
+vec4 sampleHistory(vec2 texCoord) {
+	vec4 sum = vec4(0.0f);
+	float weightSum = 0.0f;
+	float weight = 1.0f;
+	for (int i = 0; i < temporalDepth; i++) {
+		int slot = (historyHead - i + historySize) % historySize;
+		sum += weight * texture(textures, vec3(texCoord, float(historyBase + slot)));
+		weightSum += weight;
+		if (temporalMode == 2) {
+			weight *= temporalDecay;
+		}
+	}
+	return sum / max(weightSum, 1.0e-6f);
+}
+
+
 void main() {
 	if (vertTexCoord[2] < 0.0f) {
 		fragColor = vertColor;
 	}
+	else if (temporalMode != 0 && int(round(vertTexCoord[2])) == historyTarget) {
+		fragColor = sampleHistory(vertTexCoord.xy);
+	}
 	else {
 		fragColor = texture(textures, vertTexCoord);
 	}
@@ -0,0 +1,462 @@
+#include "allocator.h"
+#include <algorithm>
+#include <new>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace kop;
+
+
+size_t kop::getPageSize(bool hugePages) {
+#if defined(_WIN32)
+	if (hugePages) {
+		const size_t largePage = GetLargePageMinimum();
+		if (largePage > 0) {
+			return largePage;
+		}
+	}
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	if (hugePages) {
+		return size_t(2) << 20;
+	}
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+
+void* kop::allocatePages(size_t size, bool hugePages, int numaNode) {
+	if (size == 0) {
+		return nullptr;
+	}
+#if defined(_WIN32)
+	DWORD preferredNode = NUMA_NO_PREFERRED_NODE;
+	if (numaNode == localNumaNode) {
+		PROCESSOR_NUMBER processor;
+		USHORT node = 0;
+		GetCurrentProcessorNumberEx(&processor);
+		if (GetNumaProcessorNodeEx(&processor, &node)) {
+			preferredNode = node;
+		}
+	}
+	else if (numaNode >= 0) {
+		preferredNode = static_cast<DWORD>(numaNode);
+	}
+	if (hugePages) {
+		void* data = VirtualAllocExNuma(
+			GetCurrentProcess(), nullptr, size,
+			MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES,
+			PAGE_READWRITE, preferredNode
+		);
+		if (data) {
+			return data;
+		}
+	}
+	return VirtualAllocExNuma(
+		GetCurrentProcess(), nullptr, size, MEM_COMMIT | MEM_RESERVE,
+		PAGE_READWRITE, preferredNode
+	);
+#else
+	void* data = MAP_FAILED;
+	if (hugePages) {
+		data = mmap(
+			nullptr, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0
+		);
+	}
+	if (data == MAP_FAILED) {
+		data = mmap(
+			nullptr, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+		);
+		if (data == MAP_FAILED) {
+			return nullptr;
+		}
+		if (hugePages) {
+			madvise(data, size, MADV_HUGEPAGE);
+		}
+	}
+#if defined(SYS_mbind)
+	const int policyBind = 2;
+	const int policyLocal = 4;
+	if (numaNode == localNumaNode) {
+		syscall(SYS_mbind, data, size, policyLocal, nullptr, 0, 0);
+	}
+	else if (numaNode >= 0 && numaNode < 63) {
+		const unsigned long nodeMask = 1ul << numaNode;
+		syscall(
+			SYS_mbind, data, size, policyBind,
+			&nodeMask, sizeof(nodeMask) * 8, 0
+		);
+	}
+#endif
+	return data;
+#endif
+}
+
+
+void kop::freePages(void* data, size_t size) {
+	if (!data) {
+		return;
+	}
+#if defined(_WIN32)
+	VirtualFree(data, 0, MEM_RELEASE);
+#else
+	munmap(data, size);
+#endif
+}
+
+
+cv::UMatData* CountingAllocator::allocate(
+	int dims, const int* sizes, int type, void* data,
+	size_t* step, cv::AccessFlag flags,
+	cv::UMatUsageFlags usageFlags
+) const {
+	CountingAllocator::totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	CountingAllocator::threadAllocations += 1;
+	const cv::MatAllocator* stdAllocator = cv::Mat::getStdAllocator();
+	FrameArena* arena = FrameArena::getThreadArena();
+	if (!arena || data) {
+		return stdAllocator->allocate(
+			dims, sizes, type, data, step, flags, usageFlags
+		);
+	}
+	cv::UMatData* arenaData = arena->tryAllocate(dims, sizes, type, step);
+	if (arenaData) {
+		return arenaData;
+	}
+	cv::UMatData* heapData = stdAllocator->allocate(
+		dims, sizes, type, data, step, flags, usageFlags
+	);
+	arena->recordOverflow(heapData->size);
+	return heapData;
+}
+
+
+bool CountingAllocator::allocate(
+	cv::UMatData* data, cv::AccessFlag accessFlags,
+	cv::UMatUsageFlags usageFlags
+) const {
+	return cv::Mat::getStdAllocator()->allocate(data, accessFlags, usageFlags);
+}
+
+
+void CountingAllocator::deallocate(cv::UMatData* data) const {
+	cv::Mat::getStdAllocator()->deallocate(data);
+}
+
+
+void CountingAllocator::install() {
+	static CountingAllocator allocator;
+	cv::Mat::setDefaultAllocator(&allocator);
+}
+
+
+uint64_t CountingAllocator::getTotalAllocations() {
+	return CountingAllocator::totalAllocations.load(std::memory_order_relaxed);
+}
+
+
+uint64_t CountingAllocator::getThreadAllocations() {
+	return CountingAllocator::threadAllocations;
+}
+
+
+std::atomic<uint64_t> CountingAllocator::totalAllocations = 0;
+thread_local uint64_t CountingAllocator::threadAllocations = 0;
+
+
+FrameArena::Scope::Scope(FrameArena& arena)
+	: previous(FrameArena::threadArena)
+{
+	FrameArena::threadArena = &arena;
+}
+
+
+FrameArena::Scope::~Scope() {
+	FrameArena::threadArena = this->previous;
+}
+
+
+FrameArena::~FrameArena() {
+	this->free();
+}
+
+
+bool FrameArena::reserve(size_t capacity, bool hugePages, int numaNode) {
+	if (this->liveAllocations.load() != 0) {
+		return false;
+	}
+	this->free();
+	const size_t pageSize = getPageSize(hugePages);
+	const size_t roundedCapacity = (capacity + pageSize - 1) / pageSize * pageSize;
+	this->memory = static_cast<unsigned char*>(
+		allocatePages(roundedCapacity, hugePages, numaNode)
+	);
+	if (!this->memory) {
+		return false;
+	}
+	const size_t touchStride = getPageSize(false);
+	for (size_t i = 0; i < roundedCapacity; i += touchStride) {
+		this->memory[i] = 0;
+	}
+	this->capacity = roundedCapacity;
+	this->hugePages = hugePages;
+	this->numaNode = numaNode;
+	this->offset = 0;
+	this->currentStats = ArenaStats();
+	return true;
+}
+
+
+void FrameArena::free() {
+	freePages(this->memory, this->capacity);
+	this->memory = nullptr;
+	this->capacity = 0;
+	this->offset = 0;
+}
+
+
+bool FrameArena::reset() {
+	this->frameStats = this->currentStats;
+	this->currentStats = ArenaStats();
+	if (this->liveAllocations.load() != 0) {
+		return false;
+	}
+	if (this->memory && this->frameStats.overflowBytes > 0) {
+		this->reserve(
+			this->capacity + 2 * this->frameStats.overflowBytes,
+			this->hugePages, this->numaNode
+		);
+	}
+	this->offset = 0;
+	return true;
+}
+
+
+size_t FrameArena::getCapacity() const {
+	return this->capacity;
+}
+
+
+size_t FrameArena::getLiveAllocations() const {
+	return this->liveAllocations.load();
+}
+
+
+ArenaStats FrameArena::getFrameStats() const {
+	return this->frameStats;
+}
+
+
+cv::UMatData* FrameArena::allocate(
+	int dims, const int* sizes, int type, void* data,
+	size_t* step, cv::AccessFlag flags,
+	cv::UMatUsageFlags usageFlags
+) const {
+	const cv::MatAllocator* stdAllocator = cv::Mat::getStdAllocator();
+	if (data) {
+		return stdAllocator->allocate(
+			dims, sizes, type, data, step, flags, usageFlags
+		);
+	}
+	cv::UMatData* arenaData = this->tryAllocate(dims, sizes, type, step);
+	if (arenaData) {
+		return arenaData;
+	}
+	cv::UMatData* heapData = stdAllocator->allocate(
+		dims, sizes, type, data, step, flags, usageFlags
+	);
+	this->recordOverflow(heapData->size);
+	return heapData;
+}
+
+
+bool FrameArena::allocate(
+	cv::UMatData* data, cv::AccessFlag accessFlags,
+	cv::UMatUsageFlags usageFlags
+) const {
+	return data != nullptr;
+}
+
+
+void FrameArena::deallocate(cv::UMatData* data) const {
+	if (!data) {
+		return;
+	}
+	CV_Assert(data->urefcount == 0);
+	CV_Assert(data->refcount == 0);
+	data->~UMatData();
+	this->liveAllocations -= 1;
+}
+
+
+cv::UMatData* FrameArena::tryAllocate(
+	int dims, const int* sizes, int type, size_t* step
+) const {
+	size_t total = CV_ELEM_SIZE(type);
+	for (int i = dims - 1; i >= 0; i--) {
+		if (step) {
+			step[i] = total;
+		}
+		total *= sizes[i];
+	}
+	const size_t align = FrameArena::alignment;
+	const size_t headerSize = (sizeof(cv::UMatData) + align - 1) / align * align;
+	const size_t dataSize = (total + align - 1) / align * align;
+	if (!this->memory || this->offset + headerSize + dataSize > this->capacity) {
+		return nullptr;
+	}
+	unsigned char* header = this->memory + this->offset;
+	this->offset += headerSize + dataSize;
+	cv::UMatData* data = new (header) cv::UMatData(this);
+	data->data = header + headerSize;
+	data->origdata = data->data;
+	data->size = total;
+	this->liveAllocations += 1;
+	this->currentStats.allocations += 1;
+	this->currentStats.bytes += total;
+	return data;
+}
+
+
+void FrameArena::recordOverflow(size_t bytes) const {
+	this->currentStats.overflowAllocations += 1;
+	this->currentStats.overflowBytes += bytes;
+}
+
+
+FrameArena* FrameArena::getThreadArena() {
+	return FrameArena::threadArena;
+}
+
+
+thread_local FrameArena* FrameArena::threadArena = nullptr;
+
+
+FramePool::~FramePool() {
+	this->free();
+}
+
+
+bool FramePool::allocate(
+	size_t numBuffers, int rows, int cols, int type,
+	bool hugePages
+) {
+	this->free();
+	const size_t pageSize = getPageSize(hugePages);
+	const size_t bufferSize = static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+	this->bufferStride = (bufferSize + pageSize - 1) / pageSize * pageSize;
+	this->memorySize = this->bufferStride * numBuffers;
+	this->memory = static_cast<unsigned char*>(
+		allocatePages(this->memorySize, hugePages)
+	);
+	if (!this->memory) {
+		this->memorySize = 0;
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(this->locker);
+	this->buffers.reserve(numBuffers);
+	this->refCounts.assign(numBuffers, 0);
+	this->freeHandles.reserve(numBuffers);
+	for (size_t i = 0; i < numBuffers; i++) {
+		this->buffers.emplace_back(
+			rows, cols, type, this->memory + i * this->bufferStride
+		);
+		this->freeHandles.push_back(static_cast<int>(numBuffers - 1 - i));
+	}
+	this->failedLeases = 0;
+	return true;
+}
+
+
+void FramePool::free() {
+	std::lock_guard<std::mutex> lock(this->locker);
+	this->buffers.clear();
+	this->refCounts.clear();
+	this->freeHandles.clear();
+	freePages(this->memory, this->memorySize);
+	this->memory = nullptr;
+	this->memorySize = 0;
+}
+
+
+bool FramePool::isAllocated() const {
+	return this->memory != nullptr;
+}
+
+
+int FramePool::lease() {
+	std::lock_guard<std::mutex> lock(this->locker);
+	if (this->freeHandles.empty()) {
+		this->failedLeases += 1;
+		return FramePool::nullHandle;
+	}
+	const int handle = this->freeHandles.back();
+	this->freeHandles.pop_back();
+	this->refCounts[handle] = 1;
+	return handle;
+}
+
+
+void FramePool::retain(int handle) {
+	std::lock_guard<std::mutex> lock(this->locker);
+	if (handle < 0 || handle >= static_cast<int>(this->refCounts.size())) {
+		return;
+	}
+	this->refCounts[handle] += 1;
+}
+
+
+void FramePool::release(int handle) {
+	std::lock_guard<std::mutex> lock(this->locker);
+	if (handle < 0 || handle >= static_cast<int>(this->refCounts.size())) {
+		return;
+	}
+	if (this->refCounts[handle] <= 0) {
+		return;
+	}
+	this->refCounts[handle] -= 1;
+	if (this->refCounts[handle] == 0) {
+		this->freeHandles.push_back(handle);
+	}
+}
+
+
+const cv::Mat& FramePool::at(int handle) const {
+	return this->buffers[handle];
+}
+
+
+bool FramePool::owns(const cv::Mat& image) const {
+	return (
+		this->memory && image.data >= this->memory &&
+		image.data < this->memory + this->memorySize
+	);
+}
+
+
+size_t FramePool::getNumBuffers() const {
+	return this->buffers.size();
+}
+
+
+size_t FramePool::getNumLeased() const {
+	std::lock_guard<std::mutex> lock(this->locker);
+	return this->buffers.size() - this->freeHandles.size();
+}
+
+
+uint64_t FramePool::getFailedLeases() const {
+	std::lock_guard<std::mutex> lock(this->locker);
+	return this->failedLeases;
+}
\ No newline at end of file
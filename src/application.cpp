@@ -1,6 +1,12 @@
 #include "application.h"
+#include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/photo.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <tuple>
 
 #ifdef NDEBUG
 const bool IS_DEBUG = false;
@@ -11,161 +17,97 @@ const bool IS_DEBUG = true;
 using namespace kop;
 
 
-Webcam::Webcam(
-	unsigned int cameraId,
-	int width,
-	int height
-)
-	: cameraId(cameraId)
-{
-	this->camera.open(cameraId);
-	if (!this->camera.isOpened()) {
-		this->camera.release();
-		return;
-	}
-	this->camera.set(cv::CAP_PROP_FRAME_WIDTH, width);
-	this->camera.set(cv::CAP_PROP_FRAME_HEIGHT, height);
-	this->width = static_cast<int>(
-		this->camera.get(cv::CAP_PROP_FRAME_WIDTH)
-		);
-	this->height = static_cast<int>(
-		this->camera.get(cv::CAP_PROP_FRAME_HEIGHT)
-		);
-	this->camera.release();
-}
+namespace {
 
-
-Webcam::~Webcam() {
-	this->setActive(false);
-}
-
-
-bool Webcam::isActive() const {
-	std::lock_guard<std::mutex> lock(this->activeLocker);
-	return this->stateActive;
-}
-
-
-void Webcam::setActive(bool newState) {
-	std::lock_guard<std::mutex> lock(this->activeLocker);
-	if (newState && !this->stateActive) {
-		std::thread th(&Webcam::streamingThread, this);
-		th.detach();
-	}
-	else if (!newState && this->stateActive) {
-		this->stateActive = false;
+	void addOverlayQuad(
+		Object& object, float left, float bottom, float right, float top,
+		const std::array<float, 4>& color
+	) {
+		const unsigned int base = static_cast<unsigned int>(object.vboData.size());
+		const std::array<std::array<float, 2>, 4> corners = { {
+			{ right, top }, { left, top }, { left, bottom }, { right, bottom },
+		} };
+		for (const std::array<float, 2>& corner : corners) {
+			Vertex vertex;
+			vertex.position[0] = corner[0];
+			vertex.position[1] = corner[1];
+			vertex.position[3] = 1.0f;
+			vertex.texCoord[2] = -1.0f;
+			std::copy(color.begin(), color.end(), vertex.color);
+			object.vboData.push_back(vertex);
+		}
+		for (const unsigned int element : { 0u, 1u, 2u, 0u, 3u, 2u }) {
+			object.eboData.push_back(base + element);
+		}
 	}
-}
-
 
-int Webcam::getWidth() const {
-	return this->width;
-}
 
-
-int Webcam::getHeight() const {
-	return this->height;
-}
-
-
-void Webcam::getFrame(cv::Mat& image) const {
-	std::lock_guard<std::mutex> lock(this->frameLocker);
-	if (this->rgbFrame.empty()) {
-		return;
+	void addOverlayOutline(
+		Object& object, const cv::Rect& box, const cv::Size& frameSize,
+		float offsetX, const std::array<float, 4>& color
+	) {
+		const float width = static_cast<float>(frameSize.width);
+		const float height = static_cast<float>(frameSize.height);
+		const float thicknessX = Application::overlayThickness / width;
+		const float thicknessY = 2.0f * Application::overlayThickness / height;
+		const float left = offsetX + box.x / width;
+		const float right = offsetX + (box.x + box.width) / width;
+		const float bottom = -1.0f + 2.0f * box.y / height;
+		const float top = -1.0f + 2.0f * (box.y + box.height) / height;
+		addOverlayQuad(object, left, bottom, right, bottom + thicknessY, color);
+		addOverlayQuad(object, left, top - thicknessY, right, top, color);
+		addOverlayQuad(object, left, bottom, left + thicknessX, top, color);
+		addOverlayQuad(object, right - thicknessX, bottom, right, top, color);
 	}
-	cv::flip(this->rgbFrame, image, -1);
-}
-
 
-void Webcam::openSettings() {
-	this->camera.set(cv::CAP_PROP_SETTINGS, 1);
-}
-
-
-void Webcam::setMafOrder(size_t order) {
-	std::lock_guard<std::mutex> lock(this->orderLocker);
-	if (order < 0 || order >= Webcam::maxMafOrder) {
-		return;
-	}
-	this->mafOrder = order;
 }
 
 
-const cv::Scalar Webcam::nullColor = { 0.0f, 0.0f, 0.0f, 0.0f };
-
-
-void Webcam::streamingThread() {
-	this->camera.open(this->cameraId);
-	if (!this->camera.isOpened()) {
-		this->camera.release();
-		return;
-	}
-	this->camera.set(cv::CAP_PROP_FRAME_WIDTH, this->width);
-	this->camera.set(cv::CAP_PROP_FRAME_HEIGHT, this->height);
-	{
-		std::lock_guard<std::mutex> lock(this->activeLocker);
-		this->stateActive = true;
-	}
-	this->threadLoop();
-	{
-		std::lock_guard<std::mutex> lock(this->activeLocker);
-		this->stateActive = false;
-	}
-	this->camera.release();
+bool PipelineSettings::operator==(const PipelineSettings& other) const {
+	const auto fields = [](const PipelineSettings& settings) {
+		return std::tie(
+			settings.lowerHSV, settings.upperHSV, settings.blobsEnabled,
+			settings.blobMinArea, settings.roiTracking, settings.roiRefreshInterval,
+			settings.blurSize, settings.blurType, settings.pyramidLevel,
+			settings.histogramsEnabled, settings.histogramDecay,
+			settings.calibrationRegion, settings.graphEnabled, settings.graphLoads
+		);
+	};
+	return fields(*this) == fields(other);
 }
 
 
-void Webcam::threadLoop() {
-	cv::Mat mafFrame = cv::Mat(this->height, this->width, CV_8UC3);
-	std::array<cv::Mat, Webcam::maxMafOrder> mafBuffer = {};
-	bool mafIsComplete = false;
-	size_t mafCurrentOrder = NULL;
-	size_t mafIter = 0;
-	while (this->camera.isOpened() && this->isActive()) {
-		{
-			std::lock_guard<std::mutex> lock(this->orderLocker);
-			mafCurrentOrder = this->mafOrder;
-		}
-		this->camera >> mafBuffer[mafIter];
-		mafIter += 1;
-		if (mafIter >= mafCurrentOrder) {
-			mafIter = 0;
-		}
-		mafIsComplete = this->movingAverageFilter(
-			mafCurrentOrder, mafFrame, mafBuffer
-		);
-		if (mafIsComplete) {
-			{
-				std::lock_guard<std::mutex> lock(this->frameLocker);
-				cv::cvtColor(
-					mafFrame, this->rgbFrame, cv::COLOR_BGR2RGB
-				);
-			}
-		}
-	}
+bool PipelineSettings::operator!=(const PipelineSettings& other) const {
+	return !(*this == other);
 }
 
 
-bool Webcam::movingAverageFilter(
-	size_t order, cv::Mat& image, 
-	std::array<cv::Mat, maxMafOrder>& buffer
-) {
-	const float weight = 1.0f / order;
-	image.setTo(Webcam::nullColor);
-	for (size_t i = 0; i < order; i++) {
-		const cv::Mat& bufferImage = buffer[i];
-		if (bufferImage.empty()) {
-			return false;
-		}
-		image += weight * bufferImage;
+void LoopStats::update(bool isProcessed) {
+	this->presentedFrames += 1;
+	this->processedFrames += isProcessed ? 1 : 0;
+	const auto now = std::chrono::steady_clock::now();
+	const double seconds = std::chrono::duration<double>(
+		now - this->windowStart
+	).count();
+	if (now - this->windowStart < LoopStats::window) {
+		return;
 	}
-	return true;
+	const double cpuSeconds = getProcessCpuSeconds();
+	this->presentedPerSecond = this->presentedFrames / seconds;
+	this->processedPerSecond = this->processedFrames / seconds;
+	this->cpuUsage = (cpuSeconds - this->windowCpuSeconds) / seconds;
+	this->presentedFrames = 0;
+	this->processedFrames = 0;
+	this->windowStart = now;
+	this->windowCpuSeconds = cpuSeconds;
 }
 
 
 Application::Application(Webcam& webcam, Renderer& renderer) 
 	: webcam(&webcam),
-	  renderer(&renderer)
+	  renderer(&renderer),
+	  frameSize(webcam.getWidth(), webcam.getHeight()),
+	  captureFormat(static_cast<int>(webcam.getFormat()))
 {
 	this->imguiWindowFlags |= ImGuiWindowFlags_AlwaysAutoResize;
 	this->imguiWindowFlags |= ImGuiWindowFlags_NoNavInputs;
@@ -180,38 +122,152 @@ Application::Application(Webcam& webcam, Renderer& renderer)
 
 
 void Application::run() {
+	this->reserveArena();
+	if (!this->publishName.empty()) {
+		this->createPublisher();
+	}
+	this->webcam->setFrameListener(glfwPostEmptyEvent);
 	this->webcam->setActive(true);
 	this->createOriginalRect();
 	this->createFilteredRect();
 	GLFWwindow* window = this->renderer->getWindow();
 	bool imagesAreAcquired = false;
 	while (!imagesAreAcquired) {
+		this->webcam->waitFrame(
+			this->webcam->getFrameSequence(),
+			Application::startupFrameTimeout
+		);
 		imagesAreAcquired = this->acquireImages();
 	}
 	glfwShowWindow(window);
+	if (this->recordViewOnStart) {
+		this->renderer->startRecording(this->viewRecordingPath, Application::viewRecordingFps);
+	}
+	this->processor.setTileTracking(true);
+	this->observedSequence = this->webcam->getFrameSequence();
 	while (!glfwWindowShouldClose(window)) {
-		imagesAreAcquired = this->acquireImages();
-		this->webcam->setMafOrder(this->mafOrder);
+		this->waitForEvents();
+		const uint64_t sequence = this->webcam->getFrameSequence();
+		const bool hasNewFrame = (sequence != this->observedSequence);
+		this->observedSequence = sequence;
+		this->qualityController.setTargetMillis(this->qualityTargetMillis);
+		this->qualityController.setPyramidSupported(
+			!isYuvFormat(this->webcam->getMode().format)
+		);
+		this->qualityController.setBaseline(this->getQualityBaseline());
+		const QualitySettings quality = this->graphEnabled
+			? this->getQualityBaseline()
+			: this->qualityController.getSettings();
+		const PipelineSettings pipeline = this->getPipelineSettings(quality);
+		const bool isPipelineChanged = (pipeline != this->processedPipeline);
+		const bool isProcessed = (
+			hasNewFrame || isPipelineChanged || this->pendingCalibration
+		) && !this->isFrameSkipped(quality.frameSkip);
+		const auto processStartTime = std::chrono::steady_clock::now();
+		if (isProcessed) {
+			imagesAreAcquired = this->acquireImages();
+			this->processedPipeline = pipeline;
+		}
+		if (isProcessed && this->pendingCalibration && !this->graphEnabled) {
+			this->calibrateRange();
+		}
+		if (isProcessed && imagesAreAcquired && !this->graphEnabled) {
+			this->qualityController.update(std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - processStartTime
+			).count());
+		}
+		this->webcam->setMafOrder(quality.mafOrder);
+		this->renderer->setTemporalFilter(this->getTemporalFilter());
 		this->renderer->clear();
 		this->initGUIFrame();
+		this->updateRegionSelection();
 
 		if (imagesAreAcquired) {
 			this->renderer->add(this->originalRect);
 			this->renderer->add(this->filteredRect);
-			this->renderer->updateTexture(this->originalFrame.data, 0);
-			this->renderer->updateTexture(this->filteredFrame.data, 1);
+			if (isProcessed) {
+				this->uploadFrames();
+			}
+			this->createOverlay();
+			if (!this->overlay.vboData.empty()) {
+				this->renderer->add(this->overlay);
+			}
 		}
 		this->addGUIColorPickers();
 		this->addGUIWebcamSettings();
+		this->addGUIBlobs();
+		this->addGUITemporal();
+		ImGui::BeginDisabled(this->graphEnabled);
+		this->addGUITracking();
+		this->addGUISmoothing();
+		this->addGUIPyramid();
+		this->addGUIQuality();
+		this->addGUICalibration();
+		ImGui::EndDisabled();
+		this->addGUISweep();
+		this->addGUIGraph();
+		this->addGUIViewRecording();
+		this->addGUIMemoryStats();
+		this->addGUILoopStats();
 
 		this->renderGUIFrame();
 		this->renderer->render();
 		this->renderer->present();
+		this->loopStats.update(isProcessed);
 	}
 	
 	// End
+	this->renderer->stopRecording();
 	glfwHideWindow(window);
+	this->webcam->setFrameListener(nullptr);
 	this->webcam->setActive(false);
+	this->publisher.destroy();
+}
+
+
+void Application::setArenaOptions(bool hugePages, int numaNode) {
+	this->arenaHugePages = hugePages;
+	this->arenaNumaNode = numaNode;
+}
+
+
+void Application::setRecordingPath(const std::string& path) {
+	this->recordingPath = path;
+}
+
+
+void Application::setPublishName(const std::string& name, bool packedMask) {
+	this->publishName = name;
+	this->publishPacked = packedMask;
+}
+
+
+void Application::setViewRecordingPath(const std::string& path, bool startNow) {
+	this->viewRecordingPath = path;
+	this->recordViewOnStart = startNow;
+}
+
+
+bool Application::loadSweepLabels(const std::string& path) {
+	const cv::Mat labels = cv::imread(path, cv::IMREAD_GRAYSCALE);
+	if (labels.empty() || labels.size() != this->frameSize) {
+		return false;
+	}
+	this->sweepLabels = labels;
+	return true;
+}
+
+
+bool Application::loadGraph(const std::string& path) {
+	this->graphEnabled = this->graph.load(path) && this->processor.setGraph(&this->graph);
+	this->graphLoads += 1;
+	this->graphSchedule = this->graphEnabled ? this->graph.describeSchedule() : std::string();
+	return this->graphEnabled;
+}
+
+
+const std::string& Application::getGraphError() const {
+	return this->graph.getError();
 }
 
 
@@ -281,27 +337,332 @@ void Application::createFilteredRect() {
 }
 
 
-bool Application::acquireImages() {
-	this->outLowerHSV[0] = 180.0f * this->inLowerHSV[0];
-	this->outLowerHSV[1] = 255.0f * this->inLowerHSV[1];
-	this->outLowerHSV[2] = 255.0f * this->inLowerHSV[2];
-	this->outUpperHSV[0] = 180.0f * this->inUpperHSV[0];
-	this->outUpperHSV[1] = 255.0f * this->inUpperHSV[1];
-	this->outUpperHSV[2] = 255.0f * this->inUpperHSV[2];
-	this->webcam->getFrame(this->rgbFrame);
-	if (this->rgbFrame.empty()) {
+void Application::createOverlay() {
+	const std::array<float, 4> blobColor = { 0.0f, 1.0f, 0.0f, 1.0f };
+	const std::array<float, 4> roiColor = { 1.0f, 0.0f, 0.0f, 1.0f };
+	const std::array<float, 4> regionColor = { 1.0f, 1.0f, 0.0f, 1.0f };
+	const cv::Size& frameSize = this->frameSize;
+	const std::vector<Blob>& blobs = this->processor.getBlobs();
+	const size_t numBlobs = std::min(blobs.size(), Application::maxOverlayBlobs);
+	this->overlay.vboData.clear();
+	this->overlay.eboData.clear();
+	for (const float offsetX : { -1.0f, 0.0f }) {
+		for (size_t i = 0; i < numBlobs; i++) {
+			addOverlayOutline(
+				this->overlay, blobs[i].boundingBox, frameSize, offsetX, blobColor
+			);
+		}
+	}
+	const cv::Rect& roi = this->processor.getProcessedRoi();
+	if (roi.size() != frameSize) {
+		addOverlayOutline(this->overlay, roi, frameSize, -1.0f, roiColor);
+	}
+	const cv::Rect& region = this->isDragging
+		? this->selectionRegion
+		: this->calibrationRegion;
+	if (!region.empty()) {
+		addOverlayOutline(this->overlay, region, frameSize, -1.0f, regionColor);
+	}
+	this->overlay.applyTransform();
+}
+
+
+bool Application::reserveArena() {
+	this->isArenaReserved = this->processor.reserveArena(
+		static_cast<size_t>(this->frameSize.area()) * 4,
+		this->arenaHugePages, this->arenaNumaNode
+	);
+	return this->isArenaReserved;
+}
+
+
+bool Application::createPublisher() {
+	const bool isCreated = this->publisher.create(
+		this->publishName, this->frameSize.width, this->frameSize.height,
+		this->publishPacked
+	);
+	if (!isCreated && !this->isPublishPending) {
+		std::cerr << "Publisher: Cannot create " << this->publishName << ", retrying." << std::endl;
+	}
+	this->isPublishPending = !isCreated;
+	return isCreated;
+}
+
+
+bool Application::resizeFrames(const cv::Size& size) {
+	if (size == this->frameSize) {
+		return true;
+	}
+	const auto startTime = std::chrono::steady_clock::now();
+	if (!this->renderer->resizeTextures(size.width, size.height)) {
 		return false;
 	}
-	this->filteredFrame.setTo(Webcam::nullColor);
-	cv::GaussianBlur(this->rgbFrame, this->blurredFrame, { 5, 5 }, 5, 5);
-	cv::cvtColor(this->blurredFrame, this->originalFrame, cv::COLOR_RGB2RGBA);
-	cv::cvtColor(this->blurredFrame, this->hsvImage, cv::COLOR_RGB2HSV);
-	cv::inRange(this->hsvImage, this->outLowerHSV, this->outUpperHSV, this->hsvMask);
-	cv::copyTo(this->originalFrame, this->filteredFrame, this->hsvMask);
+	this->frameSize = size;
+	this->reserveArena();
+	if (!this->publishName.empty()) {
+		this->createPublisher();
+	}
+	if (!this->sweepLabels.empty() && this->sweepLabels.size() != size) {
+		this->sweepLabels.release();
+		this->thresholdSweep.reset();
+		this->sweepResults.clear();
+	}
+	this->calibrationRegion &= cv::Rect(cv::Point(), size);
+	this->selectionRegion = cv::Rect();
+	this->isDragging = false;
+	this->resizeMillis = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime
+	).count();
 	return true;
 }
 
 
+bool Application::acquireImages() {
+	this->processor.setRange(this->inLowerHSV, this->inUpperHSV);
+	this->processor.setBlobOptions(
+		this->blobsEnabled, static_cast<uint64_t>(this->blobMinArea)
+	);
+	this->processor.setRoiTracking(
+		this->roiTracking && !isYuvFormat(this->webcam->getMode().format),
+		this->roiRefreshInterval
+	);
+	const QualitySettings& quality = this->qualityController.getSettings();
+	this->processor.setPyramidLevel(quality.pyramidLevel);
+	this->processor.setBlurSize(quality.blurSize);
+	this->processor.setBlurType(static_cast<BlurType>(this->blurType));
+	this->processor.setStatistics(
+		this->histogramsEnabled, this->calibrationRegion, this->histogramDecay
+	);
+	this->processor.setGraph(this->graphEnabled ? &this->graph : nullptr);
+	const uint64_t sequence = this->webcam->getFrameSequence();
+	const int handle = this->webcam->acquireFrame();
+	if (handle == FramePool::nullHandle) {
+		return false;
+	}
+	const CaptureMode& mode = this->webcam->getFrameMode(handle);
+	if (!this->resizeFrames(cv::Size(mode.width, mode.height))) {
+		this->webcam->releaseFrame(handle);
+		return false;
+	}
+	if (!this->isArenaReserved) {
+		this->reserveArena();
+	}
+	if (this->isPublishPending) {
+		this->createPublisher();
+	}
+	const cv::Mat& frame = this->webcam->readFrame(handle);
+	const bool isProcessed = isYuvFormat(mode.format)
+		? this->processor.processNative(frame, mode.format, true)
+		: this->processor.processRgb(frame, true);
+	this->webcam->releaseFrame(handle);
+	this->processedSequence = sequence;
+	if (isProcessed && this->publisher.isCreated() && sequence != this->publishedSequence) {
+		this->publisher.publish(
+			this->processor.getMask(), this->processor.getFilteredFrame(),
+			this->webcam->getFrameTimestamp()
+		);
+		this->publishedSequence = sequence;
+	}
+	return isProcessed;
+}
+
+
+void Application::uploadTexture(
+	const cv::Mat& image, const DirtyTiles& tiles, size_t index
+) {
+	if (tiles.getDirtyRatio() > Application::fullUploadRatio) {
+		this->renderer->updateTexture(image.data, index);
+	}
+	else if (tiles.getNumDirty() > 0) {
+		this->renderer->updateTextureRegions(
+			image.data, index, tiles.getDirtyRects()
+		);
+	}
+}
+
+
+void Application::uploadFrames() {
+	const TemporalFilter& filter = this->renderer->getTemporalFilter();
+	if (filter.mode != TemporalMode::Off) {
+		if (this->processedSequence != this->historySequence) {
+			this->renderer->pushHistoryFrame(this->processor.getOriginalFrame().data);
+			this->historySequence = this->processedSequence;
+		}
+	}
+	else if (this->historyWasActive) {
+		this->renderer->updateTexture(
+			this->processor.getOriginalFrame().data, Renderer::historyTarget
+		);
+	}
+	else {
+		this->uploadTexture(
+			this->processor.getOriginalFrame(),
+			this->processor.getOriginalTiles(), Renderer::historyTarget
+		);
+	}
+	this->historyWasActive = (filter.mode != TemporalMode::Off);
+	this->uploadTexture(
+		this->processor.getFilteredFrame(),
+		this->processor.getFilteredTiles(), 1
+	);
+}
+
+
+TemporalFilter Application::getTemporalFilter() const {
+	TemporalFilter filter;
+	filter.mode = this->gpuTemporal
+		? static_cast<TemporalMode>(this->temporalMode)
+		: TemporalMode::Off;
+	filter.depth = this->temporalDepth;
+	filter.decay = this->temporalDecay;
+	return filter;
+}
+
+
+QualitySettings Application::getQualityBaseline() const {
+	QualitySettings settings;
+	settings.mafOrder = this->gpuTemporal ? 1 : this->mafOrder;
+	settings.blurSize = this->blurSize;
+	settings.pyramidLevel = isYuvFormat(this->webcam->getMode().format)
+		? 0
+		: this->pyramidLevel;
+	settings.frameSkip = 1;
+	return settings;
+}
+
+
+bool Application::isFrameSkipped(int frameSkip) const {
+	if (frameSkip <= 1) {
+		return false;
+	}
+	const uint64_t sequence = this->webcam->getFrameSequence();
+	return sequence - this->processedSequence < static_cast<uint64_t>(frameSkip);
+}
+
+
+void Application::waitForEvents() {
+	const uint64_t notifiedSequence = this->webcam->getNotifiedSequence();
+	if (!this->eventDriven) {
+		glfwPollEvents();
+		this->wakeupSequence = notifiedSequence;
+		return;
+	}
+	if (this->pendingRedraws > 0) {
+		glfwPollEvents();
+		this->wakeupSequence = notifiedSequence;
+		this->pendingRedraws -= 1;
+		return;
+	}
+	const uint64_t sequence = this->webcam->getFrameSequence();
+	if (sequence != this->observedSequence) {
+		glfwPollEvents();
+		this->wakeupSequence = notifiedSequence;
+		return;
+	}
+	const bool hasStaleWakeup = (notifiedSequence != this->wakeupSequence);
+	const auto startTime = std::chrono::steady_clock::now();
+	glfwWaitEventsTimeout(
+		std::chrono::duration<double>(Application::idleRedrawInterval).count()
+	);
+	this->wakeupSequence = notifiedSequence;
+	const bool isWokenEarly = (
+		std::chrono::steady_clock::now() - startTime < Application::idleRedrawInterval
+	);
+	const bool hasInput = isWokenEarly && !hasStaleWakeup &&
+		this->webcam->getFrameSequence() == sequence;
+	if (hasInput) {
+		this->pendingRedraws = Application::inputRedrawFrames;
+	}
+}
+
+
+PipelineSettings Application::getPipelineSettings(
+	const QualitySettings& quality
+) const {
+	PipelineSettings settings;
+	settings.lowerHSV = this->inLowerHSV;
+	settings.upperHSV = this->inUpperHSV;
+	settings.blobsEnabled = this->blobsEnabled;
+	settings.blobMinArea = this->blobMinArea;
+	settings.roiTracking = this->roiTracking;
+	settings.roiRefreshInterval = this->roiRefreshInterval;
+	settings.blurSize = quality.blurSize;
+	settings.blurType = this->blurType;
+	settings.pyramidLevel = quality.pyramidLevel;
+	settings.histogramsEnabled = this->histogramsEnabled;
+	settings.histogramDecay = this->histogramDecay;
+	settings.calibrationRegion = this->calibrationRegion;
+	settings.graphEnabled = this->graphEnabled;
+	settings.graphLoads = this->graphLoads;
+	return settings;
+}
+
+
+bool Application::getFramePoint(cv::Point& point) const {
+	const ImGuiIO& io = ImGui::GetIO();
+	const float ndcX = 2.0f * io.MousePos.x / io.DisplaySize.x - 1.0f;
+	const float ndcY = 1.0f - 2.0f * io.MousePos.y / io.DisplaySize.y;
+	const int width = this->frameSize.width;
+	const int height = this->frameSize.height;
+	point.x = std::clamp(static_cast<int>((ndcX + 1.0f) * width), 0, width - 1);
+	point.y = std::clamp(
+		static_cast<int>(0.5f * (ndcY + 1.0f) * height), 0, height - 1
+	);
+	return ndcX >= -1.0f && ndcX < 0.0f && ndcY >= -1.0f && ndcY <= 1.0f;
+}
+
+
+void Application::updateRegionSelection() {
+	cv::Point point;
+	const bool isOnFrame = this->getFramePoint(point);
+	if (!this->isDragging) {
+		if (
+			this->graphEnabled || ImGui::GetIO().WantCaptureMouse ||
+			!isOnFrame || !ImGui::IsMouseClicked(ImGuiMouseButton_Left)
+		) {
+			return;
+		}
+		this->isDragging = true;
+		this->dragOrigin = point;
+	}
+	const cv::Rect frameRect(cv::Point(), this->frameSize);
+	cv::Rect region = cv::Rect(this->dragOrigin, point + cv::Point(1, 1));
+	if (
+		region.width < Application::clickRegionSize &&
+		region.height < Application::clickRegionSize
+	) {
+		const int halfSize = Application::clickRegionSize / 2;
+		region = cv::Rect(
+			this->dragOrigin - cv::Point(halfSize, halfSize),
+			cv::Size(Application::clickRegionSize, Application::clickRegionSize)
+		);
+	}
+	this->selectionRegion = region & frameRect;
+	if (ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+		return;
+	}
+	this->isDragging = false;
+	this->calibrationRegion = this->selectionRegion;
+	this->histogramsEnabled = true;
+	this->pendingCalibration = true;
+}
+
+
+void Application::calibrateRange() {
+	const auto startTime = std::chrono::steady_clock::now();
+	const bool isCalibrated = this->processor.getStatistics().calibrate(
+		this->calibrationCoverage, this->inLowerHSV, this->inUpperHSV
+	);
+	if (!isCalibrated) {
+		return;
+	}
+	this->calibrationMicros = std::chrono::duration<double, std::micro>(
+		std::chrono::steady_clock::now() - startTime
+	).count();
+	this->pendingCalibration = false;
+}
+
+
 void Application::initGUIFrame() const {
 	ImGui::NewFrame();
 	if (IS_DEBUG) {
@@ -350,6 +711,478 @@ void Application::addGUIWebcamSettings() {
 		"MAF Order", &this->mafOrder, 1, 
 		Webcam::maxMafOrder, "%d", this->imguiSliderFlags
 	);
+	bool isRecording = this->webcam->isRecording();
+	if (ImGui::Checkbox("Record", &isRecording)) {
+		if (isRecording) {
+			this->webcam->startRecording(this->recordingPath);
+		}
+		else {
+			this->webcam->stopRecording();
+		}
+	}
+	if (this->webcam->isRecording()) {
+		ImGui::SameLine();
+		ImGui::Text(
+			"%llu frames",
+			static_cast<unsigned long long>(this->webcam->getRecordedFrames())
+		);
+	}
+	const CaptureStats stats = this->webcam->getCaptureStats();
+	ImGui::Text(
+		"Frames: %llu (dropped %llu)",
+		static_cast<unsigned long long>(stats.frames),
+		static_cast<unsigned long long>(stats.droppedFrames)
+	);
+	ImGui::Text(
+		"Steady-state allocations: %llu",
+		static_cast<unsigned long long>(stats.steadyAllocations)
+	);
+	ImGui::Text(
+		"Fallback copies: %llu",
+		static_cast<unsigned long long>(stats.fallbackCopies)
+	);
+	if (!this->webcam->isSwitchingMode()) {
+		const CaptureMode mode = this->webcam->getMode();
+		this->captureFormat = static_cast<int>(mode.format);
+		this->captureResolution = -1;
+		for (size_t i = 0; i < Application::captureResolutions.size(); i++) {
+			const std::array<int, 2>& size = Application::captureResolutions[i];
+			if (size[0] == mode.width && size[1] == mode.height) {
+				this->captureResolution = static_cast<int>(i);
+			}
+		}
+	}
+	const std::array<const char*, 4> formatNames = {
+		"BGR", "YUYV", "NV12", "MJPEG",
+	};
+	const std::string resolution = std::to_string(this->frameSize.width) + "x" +
+		std::to_string(this->frameSize.height);
+	ImGui::PushItemWidth(0.4f * windowWidth);
+	bool isModeChanged = false;
+	ImGui::BeginDisabled(!this->renderer->canResizeTextures());
+	if (ImGui::BeginCombo("##Resolution", resolution.c_str())) {
+		for (size_t i = 0; i < Application::captureResolutions.size(); i++) {
+			const std::array<int, 2>& size = Application::captureResolutions[i];
+			const std::string label = std::to_string(size[0]) + "x" +
+				std::to_string(size[1]);
+			const bool isSelected = static_cast<int>(i) == this->captureResolution;
+			if (ImGui::Selectable(label.c_str(), isSelected)) {
+				this->captureResolution = static_cast<int>(i);
+				isModeChanged = true;
+			}
+		}
+		ImGui::EndCombo();
+	}
+	ImGui::EndDisabled();
+	ImGui::SameLine();
+	isModeChanged |= ImGui::Combo(
+		"Mode", &this->captureFormat, formatNames.data(),
+		static_cast<int>(formatNames.size())
+	);
+	ImGui::PopItemWidth();
+	if (isModeChanged) {
+		CaptureMode mode = this->webcam->getMode();
+		mode.format = static_cast<PixelFormat>(this->captureFormat);
+		if (this->captureResolution >= 0) {
+			mode.width = Application::captureResolutions[this->captureResolution][0];
+			mode.height = Application::captureResolutions[this->captureResolution][1];
+		}
+		this->webcam->requestMode(mode);
+	}
+	if (stats.captureLost) {
+		ImGui::Text("Capture stopped: the camera could not be reopened");
+	}
+	else if (this->webcam->isSwitchingMode()) {
+		ImGui::Text("Switching capture mode ...");
+	}
+	else if (stats.modeSwitches > 0 || stats.failedSwitches > 0) {
+		ImGui::Text(
+			"Mode switches: %llu (failed %llu), last %.1f ms + %.1f ms textures",
+			static_cast<unsigned long long>(stats.modeSwitches),
+			static_cast<unsigned long long>(stats.failedSwitches),
+			stats.switchMillis, this->resizeMillis
+		);
+	}
+}
+
+
+void Application::addGUIBlobs() {
+	ImGui::SeparatorText("Blobs");
+	ImGui::Checkbox("Extract", &this->blobsEnabled);
+	ImGui::SameLine();
+	ImGui::SliderInt(
+		"Min Area", &this->blobMinArea, 1, 10000, "%d",
+		this->imguiSliderFlags | ImGuiSliderFlags_Logarithmic
+	);
+	const std::vector<Blob>& blobs = this->processor.getBlobs();
+	ImGui::Text("Count: %zu", blobs.size());
+	for (size_t i = 0; i < std::min(blobs.size(), size_t(3)); i++) {
+		ImGui::Text(
+			"#%zu: area %llu at (%.0f, %.0f), %.0f deg",
+			i, static_cast<unsigned long long>(blobs[i].area),
+			blobs[i].centroid.x, blobs[i].centroid.y,
+			blobs[i].getOrientation() * 180.0 / CV_PI
+		);
+	}
+}
+
+
+void Application::addGUITracking() {
+	ImGui::SeparatorText("Tracking");
+	const bool isNative = isYuvFormat(this->webcam->getMode().format);
+	ImGui::BeginDisabled(isNative);
+	ImGui::Checkbox("ROI", &this->roiTracking);
+	ImGui::SameLine();
+	ImGui::SliderInt(
+		"Refresh", &this->roiRefreshInterval, 1, 120, "%d frames",
+		this->imguiSliderFlags
+	);
+	ImGui::EndDisabled();
+	if (isNative) {
+		ImGui::Text("YUV frames are always processed in full");
+	}
+	const RoiStats& stats = this->processor.getRoiTracker().getStats();
+	const cv::Rect& roi = this->processor.getProcessedRoi();
+	ImGui::Text(
+		"Hit rate: %.1f%% (%llu losses)", 100.0 * stats.getHitRate(),
+		static_cast<unsigned long long>(stats.losses)
+	);
+	ImGui::Text("Pixels skipped: %.1f%%", 100.0 * stats.getPixelSavings());
+	ImGui::Text("Window: %dx%d at (%d, %d)", roi.width, roi.height, roi.x, roi.y);
+}
+
+
+void Application::addGUISmoothing() {
+	static const char* const typeNames[] = {
+		getBlurTypeName(BlurType::Gaussian), getBlurTypeName(BlurType::Box),
+		getBlurTypeName(BlurType::Stack), getBlurTypeName(BlurType::Recursive),
+	};
+	ImGui::SeparatorText("Smoothing");
+	ImGui::Combo("Kernel", &this->blurType, typeNames, numBlurTypes);
+	int radius = this->blurSize / 2;
+	if (ImGui::SliderInt(
+		"Radius", &radius, 0, Processor::maxBlurSize / 2, "%d",
+		this->imguiSliderFlags
+	)) {
+		this->blurSize = 2 * radius + 1;
+	}
+	if (ImGui::Button("Benchmark")) {
+		this->blurBenchmark = benchmarkBlur(
+			this->processor.getOriginalFrame(), radius,
+			Application::blurBenchmarkIterations
+		);
+	}
+	if (this->blurBenchmark[0] <= 0.0) {
+		return;
+	}
+	for (size_t i = 0; i < numBlurTypes; i++) {
+		ImGui::Text(
+			"%s: %.2f ms (%.2fx)", typeNames[i], this->blurBenchmark[i],
+			this->blurBenchmark[0] / std::max(this->blurBenchmark[i], 1e-6)
+		);
+	}
+}
+
+
+void Application::addGUITemporal() {
+	static const char* const modeNames[] = { "Mean", "Exponential" };
+	ImGui::SeparatorText("Temporal");
+	ImGui::Checkbox("GPU history", &this->gpuTemporal);
+	if (!this->gpuTemporal) {
+		return;
+	}
+	int modeIndex = this->temporalMode - static_cast<int>(TemporalMode::Mean);
+	if (ImGui::Combo("Mode", &modeIndex, modeNames, 2)) {
+		this->temporalMode = modeIndex + static_cast<int>(TemporalMode::Mean);
+	}
+	ImGui::SliderInt(
+		"Depth", &this->temporalDepth, 1,
+		static_cast<int>(Renderer::maxHistoryLayers), "%d frames",
+		this->imguiSliderFlags
+	);
+	if (this->temporalMode == static_cast<int>(TemporalMode::Exponential)) {
+		ImGui::SliderFloat(
+			"Decay", &this->temporalDecay, 0.05f, 0.95f, "%.2f",
+			this->imguiSliderFlags
+		);
+	}
+	ImGui::Text(
+		"History: %zu/%zu layers on the GPU",
+		this->renderer->getHistoryCount(), Renderer::maxHistoryLayers
+	);
+}
+
+
+void Application::addGUIPyramid() {
+	static const char* const scaleNames[] = { "Full", "1/2", "1/4" };
+	ImGui::SeparatorText("Pyramid");
+	const bool isNative = isYuvFormat(this->webcam->getMode().format);
+	ImGui::BeginDisabled(isNative);
+	ImGui::Combo(
+		"Scale", &this->pyramidLevel, scaleNames, Processor::maxPyramidLevel + 1
+	);
+	ImGui::EndDisabled();
+	if (isNative) {
+		ImGui::Text("YUV frames are always processed at full resolution");
+		return;
+	}
+	const PyramidStats& stats = this->processor.getPyramidStats();
+	if (this->processor.getPyramidLevel() == 0 || stats.frames == 0) {
+		return;
+	}
+	ImGui::Text("Accuracy: %.2f%% IoU vs full resolution", 100.0 * stats.accuracy);
+	ImGui::Text(
+		"Speedup: %.2fx (%.2f ms vs %.2f ms)", stats.getSpeedup(),
+		stats.pyramidMillis, stats.referenceMillis
+	);
+	ImGui::Text(
+		"Refined: %llu boundary pixels",
+		static_cast<unsigned long long>(stats.refinedPixels)
+	);
+}
+
+
+void Application::addGUIQuality() {
+	ImGui::SeparatorText("Quality");
+	bool isAdaptive = this->qualityController.isEnabled();
+	if (ImGui::Checkbox("Adaptive", &isAdaptive)) {
+		this->qualityController.setEnabled(isAdaptive);
+	}
+	ImGui::SameLine();
+	ImGui::SliderFloat(
+		"Target", &this->qualityTargetMillis, 5.0f, 50.0f, "%.1f ms",
+		this->imguiSliderFlags
+	);
+	ImGui::Text(
+		"Level %zu/%zu: %s", this->qualityController.getLevel(),
+		this->qualityController.getNumLevels() - 1,
+		this->qualityController.getSettings().toString().c_str()
+	);
+	ImGui::Text(
+		"Processing: %.1f ms/frame (%llu transitions)",
+		this->qualityController.getAverageMillis(),
+		static_cast<unsigned long long>(this->qualityController.getTransitions())
+	);
+}
+
+
+void Application::addGUISweep() {
+	ImGui::SeparatorText("Sweep");
+	if (this->sweepLabels.empty()) {
+		ImGui::TextDisabled("No labels loaded (--labels=mask.png), ranking by pixels");
+	}
+	if (ImGui::Button("Sweep frame")) {
+		const auto startTime = std::chrono::steady_clock::now();
+		const cv::Mat& original = this->processor.getOriginalFrame();
+		cv::Mat hsv = this->processor.getHsvImage();
+		const bool isFullFrame = !this->graphEnabled &&
+			this->processor.getPyramidLevel() == 0 &&
+			this->processor.getProcessedRoi().size() == original.size() &&
+			hsv.size() == original.size();
+		if (!isFullFrame) {
+			cv::Mat rgb;
+			cv::cvtColor(original, rgb, cv::COLOR_RGBA2RGB);
+			cv::cvtColor(rgb, hsv, cv::COLOR_RGB2HSV);
+		}
+		this->thresholdSweep.accumulate(hsv, this->sweepLabels);
+		const std::vector<HsvRange> candidates = ThresholdSweep::generateCandidates(
+			HsvRange::fromNormalized(this->inLowerHSV, this->inUpperHSV)
+		);
+		this->sweepResults = this->thresholdSweep.evaluate(
+			candidates, Application::maxSweepResults
+		);
+		this->sweepCandidates = candidates.size();
+		this->sweepMillis = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - startTime
+		).count();
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Reset##Sweep")) {
+		this->thresholdSweep.reset();
+		this->sweepResults.clear();
+	}
+	if (this->sweepResults.empty()) {
+		return;
+	}
+	ImGui::Text(
+		"%llu frames, %zu candidates in %.1f ms",
+		static_cast<unsigned long long>(this->thresholdSweep.getFrames()),
+		this->sweepCandidates, this->sweepMillis
+	);
+	for (size_t i = 0; i < this->sweepResults.size(); i++) {
+		const SweepResult& result = this->sweepResults[i];
+		ImGui::PushID(static_cast<int>(i));
+		if (ImGui::SmallButton("Apply")) {
+			result.range.toNormalized(this->inLowerHSV, this->inUpperHSV);
+		}
+		ImGui::SameLine();
+		if (this->thresholdSweep.hasLabels()) {
+			ImGui::Text(
+				"F %.3f (P %.2f R %.2f) H %d-%d S %d-%d V %d-%d",
+				result.score, result.precision, result.recall,
+				result.range.lower[0], result.range.upper[0],
+				result.range.lower[1], result.range.upper[1],
+				result.range.lower[2], result.range.upper[2]
+			);
+		}
+		else {
+			ImGui::Text(
+				"%llu px H %d-%d S %d-%d V %d-%d",
+				static_cast<unsigned long long>(result.pixels),
+				result.range.lower[0], result.range.upper[0],
+				result.range.lower[1], result.range.upper[1],
+				result.range.lower[2], result.range.upper[2]
+			);
+		}
+		ImGui::PopID();
+	}
+}
+
+
+void Application::addGUICalibration() {
+	const HsvStatistics& statistics = this->processor.getStatistics();
+	ImGui::SeparatorText("Calibration");
+	ImGui::Checkbox("Histograms", &this->histogramsEnabled);
+	ImGui::SliderFloat(
+		"Decay", &this->histogramDecay, 0.0f, 1.0f, "%.2f", this->imguiSliderFlags
+	);
+	ImGui::SliderFloat(
+		"Coverage", &this->calibrationCoverage, 0.5f, 1.0f, "%.2f",
+		this->imguiSliderFlags
+	);
+	if (this->calibrationRegion.empty()) {
+		ImGui::TextDisabled("Drag on the original view to select a region");
+		return;
+	}
+	ImGui::Text(
+		"Region: %dx%d at (%d, %d)",
+		this->calibrationRegion.width, this->calibrationRegion.height,
+		this->calibrationRegion.x, this->calibrationRegion.y
+	);
+	ImGui::Text(
+		"Samples: %.0f frame, %.0f region",
+		statistics.getFrameTotal(), statistics.getRegionTotal()
+	);
+	if (ImGui::Button("Calibrate")) {
+		this->histogramsEnabled = true;
+		this->pendingCalibration = true;
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Clear##Calibration")) {
+		this->calibrationRegion = cv::Rect();
+		this->pendingCalibration = false;
+	}
+	if (this->calibrationMicros > 0.0) {
+		ImGui::Text("Last calibration: %.1f us", this->calibrationMicros);
+	}
+}
+
+
+void Application::addGUIGraph() {
+	if (this->graphSchedule.empty()) {
+		return;
+	}
+	ImGui::SeparatorText("Graph");
+	ImGui::Checkbox("Enabled##Graph", &this->graphEnabled);
+	if (this->graphEnabled) {
+		ImGui::TextDisabled("Tracking, smoothing, pyramid, quality and calibration are bypassed");
+	}
+	ImGui::Text(
+		"%zu stages, %zu kernels, %zu levels, %zu buffers",
+		this->graph.getNumStages(), this->graph.getNumGroups(),
+		this->graph.getNumLevels(), this->graph.getNumBuffers()
+	);
+	ImGui::TextUnformatted(this->graphSchedule.c_str());
+}
+
+
+void Application::addGUIViewRecording() {
+	ImGui::SeparatorText("View Recording");
+	bool isRecording = this->renderer->isRecording();
+	if (ImGui::Checkbox("Record view", &isRecording)) {
+		if (isRecording) {
+			this->renderer->startRecording(
+				this->viewRecordingPath, Application::viewRecordingFps
+			);
+		}
+		else {
+			this->renderer->stopRecording();
+		}
+	}
+	ImGui::SameLine();
+	ImGui::TextUnformatted(this->viewRecordingPath.c_str());
+	if (!this->renderer->isRecording()) {
+		return;
+	}
+	const RecordingStats stats = this->renderer->getRecordingStats();
+	ImGui::Text(
+		"Frames: %llu captured, %llu encoded, %llu dropped",
+		static_cast<unsigned long long>(stats.captured),
+		static_cast<unsigned long long>(stats.encoder.encoded),
+		static_cast<unsigned long long>(stats.encoder.dropped + stats.readbackDrops)
+	);
+	ImGui::Text(
+		"Pacing: %llu duplicated, %llu skipped at %.0f fps",
+		static_cast<unsigned long long>(stats.encoder.duplicated),
+		static_cast<unsigned long long>(stats.encoder.skipped),
+		Application::viewRecordingFps
+	);
+	ImGui::Text(
+		"Overhead: %.2f ms/frame render thread, %.2f ms/frame encoder (queue %zu)",
+		stats.captureMillis, stats.encoder.encodeMillis, stats.encoder.queued
+	);
+}
+
+
+void Application::addGUIMemoryStats() {
+	const FrameArena& arena = this->processor.getArena();
+	const ArenaStats stats = arena.getFrameStats();
+	ImGui::SeparatorText("Memory");
+	ImGui::Text(
+		"Texture upload: %.1f KB/frame (filtered %zu/%zu tiles)",
+		this->renderer->getUploadedBytes() / 1024.0,
+		this->processor.getFilteredTiles().getNumDirty(),
+		this->processor.getFilteredTiles().getNumTiles()
+	);
+	ImGui::Text(
+		"Arena: %.1f MB reserved",
+		arena.getCapacity() / (1024.0 * 1024.0)
+	);
+	if (!this->isArenaReserved) {
+		ImGui::SameLine();
+		ImGui::Text("(reservation failed, using heap)");
+	}
+	ImGui::Text(
+		"Per frame: %llu allocations, %.1f KB",
+		static_cast<unsigned long long>(stats.allocations),
+		stats.bytes / 1024.0
+	);
+	ImGui::Text(
+		"Heap overflow: %llu allocations, %.1f KB",
+		static_cast<unsigned long long>(stats.overflowAllocations),
+		stats.overflowBytes / 1024.0
+	);
+	if (this->publisher.isCreated()) {
+		ImGui::Text(
+			"Published: %llu frames to %s",
+			static_cast<unsigned long long>(this->publisher.getPublishedFrames()),
+			this->publisher.getName().c_str()
+		);
+	}
+	else if (this->isPublishPending) {
+		ImGui::Text("Publishing to %s: waiting to recreate", this->publishName.c_str());
+	}
+}
+
+
+void Application::addGUILoopStats() {
+	ImGui::SeparatorText("Loop");
+	ImGui::Checkbox("Event-driven", &this->eventDriven);
+	ImGui::Text(
+		"Presented: %.1f fps, processed: %.1f fps",
+		this->loopStats.presentedPerSecond, this->loopStats.processedPerSecond
+	);
+	ImGui::Text("CPU: %.1f%% of one core", 100.0 * this->loopStats.cpuUsage);
 }
 
 
@@ -0,0 +1,410 @@
+#include "batch.h"
+#include "mask.h"
+#include "recording.h"
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace kop;
+
+
+namespace {
+
+	bool parseFloat(const std::string& text, float& number) {
+		try {
+			size_t length = 0;
+			number = std::stof(text, &length);
+			return length == text.size();
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+
+	bool parseInteger(const std::string& text, int& number) {
+		try {
+			size_t length = 0;
+			number = std::stoi(text, &length);
+			return length == text.size();
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+
+	bool parseTriple(const std::string& value, std::array<float, 3>& triple) {
+		std::stringstream ss(value);
+		std::string item;
+		for (float& component : triple) {
+			if (!std::getline(ss, item, ',') || !parseFloat(item, component)) {
+				return false;
+			}
+			component = std::clamp(component, 0.0f, 1.0f);
+		}
+		return true;
+	}
+
+
+	std::string trim(const std::string& text) {
+		const size_t first = text.find_first_not_of(" \t\r");
+		if (first == std::string::npos) {
+			return std::string();
+		}
+		const size_t last = text.find_last_not_of(" \t\r");
+		return text.substr(first, last - first + 1);
+	}
+
+}
+
+
+bool BatchOptions::loadConfig(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		return false;
+	}
+	std::string line;
+	while (std::getline(file, line)) {
+		line = trim(line.substr(0, line.find('#')));
+		const size_t equals = line.find('=');
+		if (line.empty() || equals == std::string::npos) {
+			continue;
+		}
+		const std::string key = trim(line.substr(0, equals));
+		const std::string value = trim(line.substr(equals + 1));
+		if (!this->parseArgument("--" + key + "=" + value)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool BatchOptions::parseArgument(const std::string& arg) {
+	if (arg.compare(0, 2, "--") != 0) {
+		this->inputs.push_back(arg);
+		return true;
+	}
+	const size_t equals = arg.find('=');
+	if (equals == std::string::npos) {
+		if (arg == "--roi") {
+			this->roiTracking = true;
+			return true;
+		}
+		return arg == "--batch";
+	}
+	const std::string key = arg.substr(2, equals - 2);
+	const std::string value = arg.substr(equals + 1);
+	if (key == "lower") {
+		return parseTriple(value, this->lowerHSV);
+	}
+	if (key == "upper") {
+		return parseTriple(value, this->upperHSV);
+	}
+	if (key == "output") {
+		this->outputDirectory = value;
+		return true;
+	}
+	if (key == "jobs") {
+		int numJobs = 0;
+		if (!parseInteger(value, numJobs)) {
+			return false;
+		}
+		this->numJobs = static_cast<size_t>(std::max(numJobs, 0));
+		return true;
+	}
+	if (key == "sweep") {
+		this->sweepLabelsPath = value;
+		return true;
+	}
+	if (key == "graph") {
+		this->graphPath = value;
+		return true;
+	}
+	if (key == "config") {
+		return this->loadConfig(value);
+	}
+	if (key == "write") {
+		this->writeMask = value.find("mask") != std::string::npos;
+		this->writeRle = value.find("rle") != std::string::npos;
+		this->writeFiltered = value.find("filtered") != std::string::npos;
+		this->writeStats = value.find("stats") != std::string::npos;
+		return true;
+	}
+	return false;
+}
+
+
+double BatchResult::getFramesPerSecond() const {
+	if (this->seconds <= 0.0) {
+		return 0.0;
+	}
+	return this->frames / this->seconds;
+}
+
+
+BatchRunner::BatchRunner(const BatchOptions& options)
+	: options(options)
+{
+
+}
+
+
+int BatchRunner::run() {
+	const size_t numInputs = this->options.inputs.size();
+	this->results.assign(numInputs, BatchResult());
+	if (numInputs == 0) {
+		std::cerr << "Batch: No input files." << std::endl;
+		return 1;
+	}
+	if (!this->options.graphPath.empty()) {
+		ProcessingGraph graph;
+		Processor processor;
+		if (!graph.load(this->options.graphPath) || !processor.setGraph(&graph)) {
+			std::cerr << "Batch: " << graph.getError() << '.' << std::endl;
+			return 1;
+		}
+		std::cout << "Graph: " << graph.getNumStages() << " stages in "
+			<< graph.getNumGroups() << " kernels, " << graph.getNumBuffers()
+			<< " buffers" << std::endl << graph.describeSchedule() << std::endl;
+	}
+	std::filesystem::create_directories(this->options.outputDirectory);
+	const size_t numThreads = std::max(
+		static_cast<size_t>(std::thread::hardware_concurrency()), size_t(1)
+	);
+	const size_t numJobs = std::min(
+		numInputs, this->options.numJobs ? this->options.numJobs : numThreads
+	);
+	cv::setNumThreads(static_cast<int>(std::max(numThreads / numJobs, size_t(1))));
+
+	std::atomic<size_t> nextInput = 0;
+	std::mutex printLocker;
+	std::vector<std::thread> workers;
+	const auto startTime = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < numJobs; i++) {
+		workers.emplace_back([&]() {
+			while (true) {
+				const size_t index = nextInput.fetch_add(1);
+				if (index >= numInputs) {
+					return;
+				}
+				BatchResult& result = this->results[index];
+				this->processFile(this->options.inputs[index], result);
+				std::lock_guard<std::mutex> lock(printLocker);
+				if (!result.isOpened) {
+					std::cerr << "Batch: Cannot open " << result.input << '.' << std::endl;
+					continue;
+				}
+				std::cout << result.input << ": " << result.frames << " frames, "
+					<< result.getFramesPerSecond() << " fps";
+				if (this->options.roiTracking) {
+					std::cout << ", ROI skipped "
+						<< 100.0 * result.roiPixelSavings << "% of pixels";
+				}
+				std::cout << std::endl;
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	const double seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - startTime
+	).count();
+
+	uint64_t totalFrames = 0;
+	bool allOpened = true;
+	for (const BatchResult& result : this->results) {
+		totalFrames += result.frames;
+		allOpened = allOpened && result.isOpened;
+	}
+	std::cout << "Total: " << totalFrames << " frames in " << seconds << " s, "
+		<< (seconds > 0.0 ? totalFrames / seconds : 0.0) << " fps ("
+		<< numJobs << " jobs)" << std::endl;
+	return allOpened ? 0 : 1;
+}
+
+
+const std::vector<BatchResult>& BatchRunner::getResults() const {
+	return this->results;
+}
+
+
+void BatchRunner::processFile(const std::string& input, BatchResult& result) {
+	result.input = input;
+	FrameReplayer replayer;
+	cv::VideoCapture capture;
+	const bool isReplay = (
+		FrameReplayer::isRecording(input) && replayer.open(input)
+	);
+	if (!isReplay && !capture.open(input)) {
+		return;
+	}
+	result.isOpened = true;
+	const PixelFormat format = isReplay ? replayer.getFormat() : PixelFormat::BGR;
+	const int width = isReplay
+		? replayer.getWidth()
+		: static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH));
+	const int height = isReplay
+		? replayer.getHeight()
+		: static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+	const double fps = isReplay ? 0.0 : capture.get(cv::CAP_PROP_FPS);
+	const double outputFps = (fps > 0.0) ? fps : 30.0;
+	const int fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+
+	Processor processor;
+	processor.setRange(this->options.lowerHSV, this->options.upperHSV);
+	processor.setRoiTracking(this->options.roiTracking, BatchOptions::roiRefreshInterval);
+	processor.reserveArena(static_cast<size_t>(width) * height * 4);
+	ProcessingGraph graph;
+	if (!this->options.graphPath.empty() && graph.load(this->options.graphPath)) {
+		processor.setGraph(&graph);
+	}
+	cv::VideoWriter maskWriter;
+	cv::VideoWriter filteredWriter;
+	std::ofstream statsFile;
+	std::ofstream rleFile;
+	PackedMask packedMask;
+	RleMask rleMask;
+	if (this->options.writeMask) {
+		maskWriter.open(
+			this->getOutputPath(input, "_mask.avi"), fourcc,
+			outputFps, { width, height }, false
+		);
+	}
+	if (this->options.writeFiltered) {
+		filteredWriter.open(
+			this->getOutputPath(input, "_filtered.avi"), fourcc,
+			outputFps, { width, height }, true
+		);
+	}
+	if (this->options.writeRle) {
+		rleFile.open(
+			this->getOutputPath(input, "_mask.krle"), std::ios::binary
+		);
+	}
+	if (this->options.writeStats) {
+		statsFile.open(this->getOutputPath(input, "_stats.csv"));
+		statsFile << "frame,timestamp_ms,mask_pixels,coverage,blobs\n";
+	}
+	ThresholdSweep sweep;
+	cv::Mat sweepLabels;
+	if (!this->options.sweepLabelsPath.empty()) {
+		sweepLabels = cv::imread(this->options.sweepLabelsPath, cv::IMREAD_GRAYSCALE);
+		if (sweepLabels.size() != cv::Size(width, height)) {
+			std::cerr << "Batch: Labels " << this->options.sweepLabelsPath
+				<< " do not match " << input << '.' << std::endl;
+			sweepLabels.release();
+		}
+	}
+
+	cv::Mat frame;
+	cv::Mat filteredBgr;
+	int64_t timestamp = 0;
+	const auto startTime = std::chrono::steady_clock::now();
+	while (true) {
+		if (isReplay) {
+			if (!replayer.readFrame(result.frames, frame, timestamp)) {
+				break;
+			}
+		}
+		else {
+			if (!capture.read(frame)) {
+				break;
+			}
+			timestamp = static_cast<int64_t>(
+				1000.0 * capture.get(cv::CAP_PROP_POS_MSEC)
+			);
+		}
+		const bool isProcessed = isYuvFormat(format)
+			? processor.processNative(frame, format, false)
+			: processor.processBgr(frame);
+		if (!isProcessed) {
+			result.frames += 1;
+			continue;
+		}
+		const cv::Mat& mask = processor.getMask();
+		if (maskWriter.isOpened()) {
+			maskWriter.write(mask);
+		}
+		if (rleFile.is_open()) {
+			packedMask.pack(mask);
+			rleMask.encode(packedMask);
+			rleMask.write(rleFile);
+		}
+		if (filteredWriter.isOpened()) {
+			cv::cvtColor(
+				processor.getFilteredFrame(), filteredBgr, cv::COLOR_RGBA2BGR
+			);
+			filteredWriter.write(filteredBgr);
+		}
+		if (statsFile.is_open()) {
+			const int maskPixels = cv::countNonZero(mask);
+			statsFile << result.frames << ','
+				<< timestamp / 1000.0 << ','
+				<< maskPixels << ','
+				<< static_cast<double>(maskPixels) / mask.total() << ','
+				<< processor.getBlobs().size() << '\n';
+		}
+		const cv::Mat& hsv = processor.getHsvImage();
+		if (!sweepLabels.empty() && hsv.size() == sweepLabels.size()) {
+			sweep.accumulate(hsv, sweepLabels);
+		}
+		result.frames += 1;
+	}
+	result.seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - startTime
+	).count();
+	result.roiPixelSavings = processor.getRoiTracker().getStats().getPixelSavings();
+	if (sweep.hasLabels()) {
+		this->writeSweep(input, sweep);
+	}
+}
+
+
+std::string BatchRunner::getOutputPath(
+	const std::string& input, const char* suffix
+) const {
+	const std::filesystem::path stem = std::filesystem::path(input).stem();
+	const std::filesystem::path output = (
+		std::filesystem::path(this->options.outputDirectory) /
+		(stem.string() + suffix)
+	);
+	return output.string();
+}
+
+
+void BatchRunner::writeSweep(
+	const std::string& input, ThresholdSweep& sweep
+) const {
+	const std::vector<HsvRange> candidates = ThresholdSweep::generateCandidates(
+		HsvRange::fromNormalized(this->options.lowerHSV, this->options.upperHSV)
+	);
+	const std::vector<SweepResult> sweepResults = sweep.evaluate(
+		candidates, BatchOptions::maxSweepResults
+	);
+	std::ofstream file(this->getOutputPath(input, "_sweep.csv"));
+	file << "lower_h,lower_s,lower_v,upper_h,upper_s,upper_v,"
+		<< "pixels,precision,recall,score\n";
+	for (const SweepResult& result : sweepResults) {
+		for (const int bound : result.range.lower) {
+			file << bound << ',';
+		}
+		for (const int bound : result.range.upper) {
+			file << bound << ',';
+		}
+		file << result.pixels << ',' << result.precision << ','
+			<< result.recall << ',' << result.score << '\n';
+	}
+}
\ No newline at end of file
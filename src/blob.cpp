@@ -0,0 +1,231 @@
+#include "blob.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace kop;
+
+
+namespace {
+
+	int findRoot(std::vector<int>& parents, int node) {
+		while (parents[node] != node) {
+			parents[node] = parents[parents[node]];
+			node = parents[node];
+		}
+		return node;
+	}
+
+
+	void unite(std::vector<int>& parents, int a, int b) {
+		a = findRoot(parents, a);
+		b = findRoot(parents, b);
+		if (a < b) {
+			parents[b] = a;
+		}
+		else if (b < a) {
+			parents[a] = b;
+		}
+	}
+
+
+	template <typename RunType, typename Unite>
+	void connectRows(
+		const RunType* upper, size_t numUpper,
+		const RunType* lower, size_t numLower,
+		Unite&& uniteRuns
+	) {
+		size_t first = 0;
+		for (size_t i = 0; i < numLower; i++) {
+			while (first < numUpper && upper[first].end < lower[i].begin) {
+				first++;
+			}
+			for (size_t j = first; j < numUpper && upper[j].begin <= lower[i].end; j++) {
+				uniteRuns(j, i);
+			}
+		}
+	}
+
+
+	double sumOfSquares(double n) {
+		return n * (n + 1.0) * (2.0 * n + 1.0) / 6.0;
+	}
+
+}
+
+
+double Blob::getOrientation() const {
+	return 0.5 * std::atan2(2.0 * this->mu11, this->mu20 - this->mu02);
+}
+
+
+void BlobExtractor::extract(const cv::Mat& mask) {
+	CV_Assert(mask.empty() || mask.type() == CV_8UC1);
+	this->blobs.clear();
+	if (mask.empty()) {
+		return;
+	}
+	const int numBands = std::max(
+		std::min(cv::getNumThreads(), mask.rows / BlobExtractor::minBandRows), 1
+	);
+	this->bands.resize(numBands);
+	for (int i = 0; i < numBands; i++) {
+		this->bands[i].firstRow = mask.rows * i / numBands;
+		this->bands[i].lastRow = mask.rows * (i + 1) / numBands;
+	}
+	cv::parallel_for_(cv::Range(0, numBands), [&](const cv::Range& range) {
+		for (int i = range.start; i < range.end; i++) {
+			this->labelBand(mask, this->bands[i]);
+		}
+	});
+
+	size_t numRuns = 0;
+	for (Band& band : this->bands) {
+		band.offset = numRuns;
+		numRuns += band.runs.size();
+	}
+	this->parents.resize(numRuns);
+	for (const Band& band : this->bands) {
+		for (size_t i = 0; i < band.runs.size(); i++) {
+			this->parents[band.offset + i] = band.parents[i] + static_cast<int>(band.offset);
+		}
+	}
+	for (size_t i = 1; i < this->bands.size(); i++) {
+		this->mergeBands(this->bands[i - 1], this->bands[i]);
+	}
+
+	this->rootBlobs.assign(numRuns, -1);
+	this->moments.clear();
+	for (const Band& band : this->bands) {
+		for (size_t i = 0; i < band.runs.size(); i++) {
+			const Run& run = band.runs[i];
+			const cv::Rect runRect(run.begin, run.y, run.end - run.begin, 1);
+			int& index = this->rootBlobs[
+				findRoot(this->parents, static_cast<int>(band.offset + i))
+			];
+			if (index < 0) {
+				index = static_cast<int>(this->moments.size());
+				this->moments.emplace_back();
+				this->moments.back().boundingBox = runRect;
+			}
+			Moments& blob = this->moments[index];
+			const double length = run.end - run.begin;
+			const double sumX = (run.begin + run.end - 1.0) * length / 2.0;
+			const double sumXX = (
+				sumOfSquares(run.end - 1.0) - sumOfSquares(run.begin - 1.0)
+			);
+			const double y = run.y;
+			blob.m00 += length;
+			blob.m10 += sumX;
+			blob.m01 += length * y;
+			blob.m20 += sumXX;
+			blob.m11 += sumX * y;
+			blob.m02 += length * y * y;
+			blob.boundingBox |= runRect;
+		}
+	}
+
+	for (const Moments& blob : this->moments) {
+		if (blob.m00 < static_cast<double>(this->minArea)) {
+			continue;
+		}
+		Blob result;
+		result.area = static_cast<uint64_t>(blob.m00);
+		result.boundingBox = blob.boundingBox;
+		result.centroid = { blob.m10 / blob.m00, blob.m01 / blob.m00 };
+		result.mu20 = blob.m20 - result.centroid.x * blob.m10;
+		result.mu11 = blob.m11 - result.centroid.x * blob.m01;
+		result.mu02 = blob.m02 - result.centroid.y * blob.m01;
+		this->blobs.push_back(result);
+	}
+	std::sort(
+		this->blobs.begin(), this->blobs.end(),
+		[](const Blob& a, const Blob& b) { return a.area > b.area; }
+	);
+}
+
+
+void BlobExtractor::setMinArea(uint64_t area) {
+	this->minArea = area;
+}
+
+
+uint64_t BlobExtractor::getMinArea() const {
+	return this->minArea;
+}
+
+
+const std::vector<Blob>& BlobExtractor::getBlobs() const {
+	return this->blobs;
+}
+
+
+void BlobExtractor::labelBand(const cv::Mat& mask, Band& band) const {
+	band.runs.clear();
+	band.parents.clear();
+	size_t previousRow = 0;
+	for (int y = band.firstRow; y < band.lastRow; y++) {
+		const uchar* row = mask.ptr(y);
+		const size_t currentRow = band.runs.size();
+		int x = 0;
+		while (x < mask.cols) {
+			uint64_t word = 0;
+			while (x + 8 <= mask.cols) {
+				std::memcpy(&word, row + x, sizeof(word));
+				if (word != 0) {
+					break;
+				}
+				x += 8;
+			}
+			while (x < mask.cols && row[x] == 0) {
+				x++;
+			}
+			if (x >= mask.cols) {
+				break;
+			}
+			const int begin = x;
+			while (x < mask.cols && row[x] != 0) {
+				x++;
+			}
+			band.parents.push_back(static_cast<int>(band.runs.size()));
+			band.runs.push_back({ y, begin, x });
+		}
+		if (y > band.firstRow) {
+			connectRows(
+				band.runs.data() + previousRow, currentRow - previousRow,
+				band.runs.data() + currentRow, band.runs.size() - currentRow,
+				[&](size_t upper, size_t lower) {
+					unite(
+						band.parents,
+						static_cast<int>(previousRow + upper),
+						static_cast<int>(currentRow + lower)
+					);
+				}
+			);
+		}
+		previousRow = currentRow;
+	}
+}
+
+
+void BlobExtractor::mergeBands(const Band& upper, const Band& lower) {
+	size_t upperBegin = upper.runs.size();
+	while (upperBegin > 0 && upper.runs[upperBegin - 1].y == upper.lastRow - 1) {
+		upperBegin--;
+	}
+	size_t lowerEnd = 0;
+	while (lowerEnd < lower.runs.size() && lower.runs[lowerEnd].y == lower.firstRow) {
+		lowerEnd++;
+	}
+	connectRows(
+		upper.runs.data() + upperBegin, upper.runs.size() - upperBegin,
+		lower.runs.data(), lowerEnd,
+		[&](size_t i, size_t j) {
+			unite(
+				this->parents,
+				static_cast<int>(upper.offset + upperBegin + i),
+				static_cast<int>(lower.offset + j)
+			);
+		}
+	);
+}
\ No newline at end of file
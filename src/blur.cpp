@@ -0,0 +1,367 @@
+#include "blur.h"
+#include "kernels.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+using namespace kop;
+
+
+namespace {
+
+	constexpr const int stripBytes = 256;
+
+
+	inline int getReciprocal(int divisor) {
+		return ((1 << fixedShift) + divisor / 2) / divisor;
+	}
+
+
+	inline uchar scaleSum(int sum, int reciprocal) {
+		return static_cast<uchar>((sum * reciprocal + fixedHalf) >> fixedShift);
+	}
+
+
+	struct RecursiveCoefficients {
+	public:
+		explicit RecursiveCoefficients(double sigma) {
+			sigma = std::max(sigma, 0.5);
+			const double q = (sigma >= 2.5)
+				? 0.98711 * sigma - 0.96330
+				: 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+			const double q2 = q * q;
+			const double q3 = q2 * q;
+			const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+			const double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+			const double b2 = -(1.4281 * q2 + 1.26661 * q3);
+			const double b3 = 0.422205 * q3;
+			this->a1 = static_cast<float>(b1 / b0);
+			this->a2 = static_cast<float>(b2 / b0);
+			this->a3 = static_cast<float>(b3 / b0);
+			this->gain = 1.0f - this->a1 - this->a2 - this->a3;
+		}
+	public:
+		float gain = 1.0f;
+		float a1 = 0.0f;
+		float a2 = 0.0f;
+		float a3 = 0.0f;
+	};
+
+
+	int getStackRadius(double sigma) {
+		return std::max(
+			static_cast<int>(std::lround(std::sqrt(6.0 * sigma * sigma + 1.0) - 1.0)), 1
+		);
+	}
+
+
+	double getBoxSigma(int radius) {
+		return std::sqrt(static_cast<double>(radius * (radius + 1) * boxBlurPasses) / 3.0);
+	}
+
+
+	void blurMatched(
+		const cv::Mat& src, cv::Mat& dst, BlurType type, int radius
+	) {
+		if (radius <= 0) {
+			src.copyTo(dst);
+			return;
+		}
+		const double sigma = getBoxSigma(radius);
+		switch (type) {
+		case BlurType::Box:
+			boxBlur(src, dst, radius);
+			break;
+		case BlurType::Stack:
+			stackBlur(src, dst, getStackRadius(sigma));
+			break;
+		case BlurType::Recursive:
+			recursiveGaussianBlur(src, dst, sigma);
+			break;
+		default:
+			cv::GaussianBlur(src, dst, cv::Size(), sigma, sigma);
+			break;
+		}
+	}
+
+
+	template <typename Function>
+	void forEachStrip(int rowBytes, const Function& function) {
+		const int numStrips = (rowBytes + stripBytes - 1) / stripBytes;
+		cv::parallel_for_(cv::Range(0, numStrips), [&](const cv::Range& strips) {
+			for (int strip = strips.start; strip < strips.end; strip++) {
+				const int begin = strip * stripBytes;
+				function(begin, std::min(stripBytes, rowBytes - begin));
+			}
+		});
+	}
+
+
+	void boxBlurRows(const cv::Mat& src, cv::Mat& dst, int radius) {
+		const int width = src.cols;
+		const int channels = src.channels();
+		const int reciprocal = getReciprocal(2 * radius + 1);
+		cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& rows) {
+			for (int y = rows.start; y < rows.end; y++) {
+				const uchar* in = src.ptr(y);
+				uchar* out = dst.ptr(y);
+				for (int c = 0; c < channels; c++) {
+					const auto at = [&](int x) -> int {
+						return in[std::clamp(x, 0, width - 1) * channels + c];
+					};
+					int sum = 0;
+					for (int k = -radius; k <= radius; k++) {
+						sum += at(k);
+					}
+					for (int x = 0; x < width; x++) {
+						out[x * channels + c] = scaleSum(sum, reciprocal);
+						sum += at(x + radius + 1) - at(x - radius);
+					}
+				}
+			}
+		});
+	}
+
+
+	void boxBlurColumns(const cv::Mat& src, cv::Mat& dst, int radius) {
+		const BlurKernels& kernels = getBlurKernels();
+		const int height = src.rows;
+		const int reciprocal = getReciprocal(2 * radius + 1);
+		const auto row = [&](int y) {
+			return src.ptr(std::clamp(y, 0, height - 1));
+		};
+		forEachStrip(src.cols * src.channels(), [&](int begin, int count) {
+			std::vector<int> sums(count, 0);
+			int* sum = sums.data();
+			for (int k = -radius; k <= radius; k++) {
+				const uchar* in = row(k) + begin;
+				for (int i = 0; i < count; i++) {
+					sum[i] += in[i];
+				}
+			}
+			for (int y = 0; y < height; y++) {
+				kernels.boxColumnStep(
+					row(y + radius + 1) + begin, row(y - radius) + begin,
+					sum, dst.ptr(y) + begin, count, reciprocal
+				);
+			}
+		});
+	}
+
+
+	void stackBlurRows(const cv::Mat& src, cv::Mat& dst, int radius) {
+		const int width = src.cols;
+		const int channels = src.channels();
+		const int reciprocal = getReciprocal((radius + 1) * (radius + 1));
+		cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& rows) {
+			for (int y = rows.start; y < rows.end; y++) {
+				const uchar* in = src.ptr(y);
+				uchar* out = dst.ptr(y);
+				for (int c = 0; c < channels; c++) {
+					const auto at = [&](int x) -> int {
+						return in[std::clamp(x, 0, width - 1) * channels + c];
+					};
+					int sum = 0;
+					int sumIn = 0;
+					int sumOut = 0;
+					for (int k = -radius; k <= radius; k++) {
+						sum += (radius + 1 - std::abs(k)) * at(k);
+						sumOut += (k <= 0) ? at(k) : 0;
+					}
+					for (int k = 1; k <= radius + 1; k++) {
+						sumIn += at(k);
+					}
+					for (int x = 0; x < width; x++) {
+						out[x * channels + c] = scaleSum(sum, reciprocal);
+						sum += sumIn - sumOut;
+						sumIn += at(x + radius + 2) - at(x + 1);
+						sumOut += at(x + 1) - at(x - radius);
+					}
+				}
+			}
+		});
+	}
+
+
+	void stackBlurColumns(const cv::Mat& src, cv::Mat& dst, int radius) {
+		const BlurKernels& kernels = getBlurKernels();
+		const int height = src.rows;
+		const int reciprocal = getReciprocal((radius + 1) * (radius + 1));
+		const auto row = [&](int y) {
+			return src.ptr(std::clamp(y, 0, height - 1));
+		};
+		forEachStrip(src.cols * src.channels(), [&](int begin, int count) {
+			std::vector<int> sums(3 * count, 0);
+			int* sum = sums.data();
+			int* sumIn = sum + count;
+			int* sumOut = sumIn + count;
+			for (int k = -radius; k <= radius + 1; k++) {
+				const uchar* in = row(k) + begin;
+				const int weight = std::max(radius + 1 - std::abs(k), 0);
+				for (int i = 0; i < count; i++) {
+					sum[i] += weight * in[i];
+					sumIn[i] += (k > 0) ? in[i] : 0;
+					sumOut[i] += (k <= 0) ? in[i] : 0;
+				}
+			}
+			for (int y = 0; y < height; y++) {
+				kernels.stackColumnStep(
+					row(y + 1) + begin, row(y + radius + 2) + begin,
+					row(y - radius) + begin, sum, sumIn, sumOut,
+					dst.ptr(y) + begin, count, reciprocal
+				);
+			}
+		});
+	}
+
+
+	void recursiveBlurRows(cv::Mat& image, const RecursiveCoefficients& k) {
+		const int width = image.cols;
+		const int channels = image.channels();
+		cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& rows) {
+			for (int y = rows.start; y < rows.end; y++) {
+				float* values = image.ptr<float>(y);
+				for (int c = 0; c < channels; c++) {
+					const auto at = [&](int x) -> float& {
+						return values[std::clamp(x, 0, width - 1) * channels + c];
+					};
+					for (int x = 1; x < width; x++) {
+						at(x) = k.gain * at(x) + k.a1 * at(x - 1) +
+							k.a2 * at(x - 2) + k.a3 * at(x - 3);
+					}
+					for (int x = width - 2; x >= 0; x--) {
+						at(x) = k.gain * at(x) + k.a1 * at(x + 1) +
+							k.a2 * at(x + 2) + k.a3 * at(x + 3);
+					}
+				}
+			}
+		});
+	}
+
+
+	void recursiveBlurColumns(cv::Mat& image, const RecursiveCoefficients& k) {
+		const BlurKernels& kernels = getBlurKernels();
+		const int height = image.rows;
+		const auto row = [&](int y) {
+			return image.ptr<float>(std::clamp(y, 0, height - 1));
+		};
+		forEachStrip(image.cols * image.channels(), [&](int begin, int count) {
+			for (int y = 1; y < height; y++) {
+				kernels.recursiveColumnStep(
+					row(y - 1) + begin, row(y - 2) + begin, row(y - 3) + begin,
+					row(y) + begin, count, k.gain, k.a1, k.a2, k.a3
+				);
+			}
+			for (int y = height - 2; y >= 0; y--) {
+				kernels.recursiveColumnStep(
+					row(y + 1) + begin, row(y + 2) + begin, row(y + 3) + begin,
+					row(y) + begin, count, k.gain, k.a1, k.a2, k.a3
+				);
+			}
+		});
+	}
+
+}
+
+
+const char* kop::getBlurTypeName(BlurType type) {
+	switch (type) {
+	case BlurType::Box:
+		return "Box";
+	case BlurType::Stack:
+		return "Stack";
+	case BlurType::Recursive:
+		return "Recursive";
+	default:
+		return "Gaussian";
+	}
+}
+
+
+void kop::boxBlur(const cv::Mat& src, cv::Mat& dst, int radius, int passes) {
+	CV_Assert(src.depth() == CV_8U);
+	cv::Mat temp;
+	temp.allocator = dst.allocator;
+	temp.create(src.size(), src.type());
+	dst.create(src.size(), src.type());
+	boxBlurRows(src, temp, radius);
+	boxBlurColumns(temp, dst, radius);
+	for (int pass = 1; pass < passes; pass++) {
+		boxBlurRows(dst, temp, radius);
+		boxBlurColumns(temp, dst, radius);
+	}
+}
+
+
+void kop::stackBlur(const cv::Mat& src, cv::Mat& dst, int radius) {
+	CV_Assert(src.depth() == CV_8U);
+	cv::Mat temp;
+	temp.allocator = dst.allocator;
+	temp.create(src.size(), src.type());
+	dst.create(src.size(), src.type());
+	stackBlurRows(src, temp, radius);
+	stackBlurColumns(temp, dst, radius);
+}
+
+
+void kop::recursiveGaussianBlur(const cv::Mat& src, cv::Mat& dst, double sigma) {
+	CV_Assert(src.depth() == CV_8U);
+	const RecursiveCoefficients coefficients(sigma);
+	cv::Mat values;
+	values.allocator = dst.allocator;
+	src.convertTo(values, CV_32F);
+	recursiveBlurRows(values, coefficients);
+	recursiveBlurColumns(values, coefficients);
+	values.convertTo(dst, src.depth());
+}
+
+
+void kop::blurImage(
+	const cv::Mat& src, cv::Mat& dst, BlurType type, int radius
+) {
+	if (radius <= 0) {
+		src.copyTo(dst);
+		return;
+	}
+	switch (type) {
+	case BlurType::Box:
+		boxBlur(src, dst, radius);
+		break;
+	case BlurType::Stack:
+		stackBlur(src, dst, radius);
+		break;
+	case BlurType::Recursive:
+		recursiveGaussianBlur(
+			src, dst, std::sqrt(static_cast<double>(radius * (radius + 1)))
+		);
+		break;
+	default: {
+		const int size = 2 * radius + 1;
+		const double sigma = static_cast<double>(size);
+		cv::GaussianBlur(src, dst, { size, size }, sigma, sigma);
+		break;
+	}
+	}
+}
+
+
+std::array<double, numBlurTypes> kop::benchmarkBlur(
+	const cv::Mat& image, int radius, int iterations
+) {
+	std::array<double, numBlurTypes> millis = {};
+	cv::Mat blurred;
+	for (size_t i = 0; i < numBlurTypes; i++) {
+		const BlurType type = static_cast<BlurType>(i);
+		blurMatched(image, blurred, type, radius);
+		const auto startTime = std::chrono::steady_clock::now();
+		for (int j = 0; j < iterations; j++) {
+			blurMatched(image, blurred, type, radius);
+		}
+		millis[i] = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - startTime
+		).count() / std::max(iterations, 1);
+	}
+	return millis;
+}
\ No newline at end of file
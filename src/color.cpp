@@ -0,0 +1,321 @@
+#include "color.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+using namespace kop;
+
+
+namespace {
+
+	void blurHalfPlane(
+		const cv::Mat& src, cv::Mat& dst, BlurType type, int radius,
+		bool isHalfHeight
+	) {
+		const int halfRadius = std::max(radius / 2, 1);
+		if (type != BlurType::Gaussian) {
+			blurImage(src, dst, type, isHalfHeight ? halfRadius : radius);
+			return;
+		}
+		const int size = 2 * radius + 1;
+		const int halfSize = 2 * halfRadius + 1;
+		const double sigma = static_cast<double>(size);
+		cv::GaussianBlur(
+			src, dst, { halfSize, isHalfHeight ? halfSize : size },
+			sigma / 2.0, isHalfHeight ? sigma / 2.0 : sigma
+		);
+	}
+
+
+	struct HsvTables {
+	public:
+		HsvTables() {
+			this->saturation[0] = 0;
+			this->hue[0] = 0;
+			for (int i = 1; i < 256; i++) {
+				this->saturation[i] = cvRound((255 << 12) / (1.0 * i));
+				this->hue[i] = cvRound((180 << 12) / (6.0 * i));
+			}
+		}
+	public:
+		std::array<int, 256> saturation = {};
+		std::array<int, 256> hue = {};
+	};
+
+
+	const HsvTables hsvTables;
+
+
+	inline uchar clampByte(int value) {
+		return static_cast<uchar>(std::clamp(value, 0, 255));
+	}
+
+
+	inline void rgbToHsv(int r, int g, int b, uchar* hsv) {
+		const int maxValue = std::max({ r, g, b });
+		const int minValue = std::min({ r, g, b });
+		const int diff = maxValue - minValue;
+		int h = 0;
+		if (diff != 0) {
+			const int scale = hsvTables.hue[diff];
+			if (maxValue == r) {
+				h = g - b;
+			}
+			else if (maxValue == g) {
+				h = b - r + 2 * diff;
+			}
+			else {
+				h = r - g + 4 * diff;
+			}
+			h = (h * scale + (1 << 11)) >> 12;
+			if (h < 0) {
+				h += 180;
+			}
+			else if (h >= 180) {
+				h -= 180;
+			}
+		}
+		hsv[0] = static_cast<uchar>(h);
+		hsv[1] = static_cast<uchar>(
+			(diff * hsvTables.saturation[maxValue] + (1 << 11)) >> 12
+		);
+		hsv[2] = static_cast<uchar>(maxValue);
+	}
+
+
+	inline void yuvToRgbaHsv(
+		int y, int u, int v, uchar* rgba, uchar* hsv
+	) {
+		const int c = std::max(y - 16, 0) * 1192;
+		const int d = u - 128;
+		const int e = v - 128;
+		const int r = clampByte((c + 1634 * e + 512) >> 10);
+		const int g = clampByte((c - 401 * d - 832 * e + 512) >> 10);
+		const int b = clampByte((c + 2066 * d + 512) >> 10);
+		rgba[0] = static_cast<uchar>(r);
+		rgba[1] = static_cast<uchar>(g);
+		rgba[2] = static_cast<uchar>(b);
+		rgba[3] = 255;
+		rgbToHsv(r, g, b, hsv);
+	}
+
+
+	template <typename RowFunction>
+	void forEachBand(
+		int height, const HsvStatistics* statistics, const RowFunction& convertRow
+	) {
+		if (!statistics) {
+			cv::parallel_for_(cv::Range(0, height), [&](const cv::Range& rows) {
+				for (int y = rows.start; y < rows.end; y++) {
+					convertRow(0, y);
+				}
+			});
+			return;
+		}
+		const int numBands = HsvStatistics::numBands;
+		cv::parallel_for_(cv::Range(0, numBands), [&](const cv::Range& bands) {
+			for (int band = bands.start; band < bands.end; band++) {
+				const int begin = height * band / numBands;
+				const int end = height * (band + 1) / numBands;
+				for (int y = begin; y < end; y++) {
+					convertRow(band, y);
+				}
+			}
+		});
+	}
+
+}
+
+
+bool kop::isYuvFormat(PixelFormat format) {
+	return format == PixelFormat::YUYV || format == PixelFormat::NV12;
+}
+
+
+size_t kop::getNativeFrameBytes(PixelFormat format, int width, int height) {
+	const size_t numPixels = static_cast<size_t>(width) * height;
+	if (format == PixelFormat::YUYV) {
+		return numPixels * 2;
+	}
+	if (format == PixelFormat::NV12) {
+		return numPixels * 3 / 2;
+	}
+	return numPixels * 3;
+}
+
+
+bool kop::reshapeNativeFrame(
+	const cv::Mat& raw, PixelFormat format,
+	int width, int height, cv::Mat& image
+) {
+	if (raw.empty() || !raw.isContinuous()) {
+		return false;
+	}
+	if (!isYuvFormat(format)) {
+		image = raw;
+		return true;
+	}
+	const size_t numBytes = raw.total() * raw.elemSize();
+	const size_t frameBytes = getNativeFrameBytes(format, width, height);
+	if (numBytes < frameBytes) {
+		return false;
+	}
+	const cv::Mat bytes = raw.reshape(1, 1).colRange(
+		0, static_cast<int>(frameBytes)
+	);
+	if (format == PixelFormat::YUYV) {
+		image = bytes.reshape(2, height);
+	}
+	else {
+		image = bytes.reshape(1, height * 3 / 2);
+	}
+	return true;
+}
+
+
+void kop::blurNativeFrame(
+	const cv::Mat& image, PixelFormat format, BlurType type, int radius,
+	cv::Mat& blurred
+) {
+	if (!isYuvFormat(format) || radius <= 0) {
+		blurImage(image, blurred, type, radius);
+		return;
+	}
+	blurred.create(image.size(), image.type());
+	if (format == PixelFormat::YUYV) {
+		const cv::Mat packed(
+			image.rows, image.cols / 2, CV_8UC4, image.data, image.step
+		);
+		cv::Mat blurredPacked(
+			blurred.rows, blurred.cols / 2, CV_8UC4,
+			blurred.data, blurred.step
+		);
+		blurHalfPlane(packed, blurredPacked, type, radius, false);
+		return;
+	}
+	const int height = image.rows * 2 / 3;
+	cv::Mat blurredLuma = blurred.rowRange(0, height);
+	blurImage(image.rowRange(0, height), blurredLuma, type, radius);
+	const cv::Mat chroma(
+		image.rows - height, image.cols / 2, CV_8UC2,
+		const_cast<uchar*>(image.ptr(height)), image.step
+	);
+	cv::Mat blurredChroma(
+		blurred.rows - height, blurred.cols / 2, CV_8UC2,
+		blurred.ptr(height), blurred.step
+	);
+	blurHalfPlane(chroma, blurredChroma, type, radius, true);
+}
+
+
+void kop::convertYuvToRgbaHsv(
+	const cv::Mat& yuv, PixelFormat format, bool flipX, bool flipY,
+	cv::Mat& rgba, cv::Mat& hsv, HsvStatistics* statistics
+) {
+	CV_Assert(isYuvFormat(format));
+	const int width = yuv.cols;
+	const int height = (format == PixelFormat::YUYV)
+		? yuv.rows
+		: yuv.rows * 2 / 3;
+	rgba.create(height, width, CV_8UC4);
+	hsv.create(height, width, CV_8UC3);
+	forEachBand(height, statistics, [&](int band, int y) {
+		const int srcY = flipY ? height - 1 - y : y;
+		const uchar* luma = yuv.ptr(srcY);
+		const uchar* chroma = (format == PixelFormat::NV12)
+			? yuv.ptr(height + srcY / 2)
+			: luma;
+		uchar* rgbaRow = rgba.ptr(y);
+		uchar* hsvRow = hsv.ptr(y);
+		for (int x = 0; x < width; x++) {
+			const int srcX = flipX ? width - 1 - x : x;
+			int lumaValue = 0;
+			int u = 0;
+			int v = 0;
+			if (format == PixelFormat::YUYV) {
+				const uchar* pair = luma + 4 * (srcX >> 1);
+				lumaValue = luma[2 * srcX];
+				u = pair[1];
+				v = pair[3];
+			}
+			else {
+				const uchar* pair = chroma + (srcX & ~1);
+				lumaValue = luma[srcX];
+				u = pair[0];
+				v = pair[1];
+			}
+			yuvToRgbaHsv(
+				lumaValue, u, v, rgbaRow + 4 * x, hsvRow + 3 * x
+			);
+		}
+		if (statistics) {
+			statistics->accumulateRow(band, y, hsvRow, width);
+		}
+	});
+}
+
+
+void kop::convertRgbToHsv(
+	const cv::Mat& image, bool isBgr, cv::Mat& hsv,
+	HsvStatistics* statistics
+) {
+	CV_Assert(image.type() == CV_8UC3);
+	hsv.create(image.size(), CV_8UC3);
+	const int redIndex = isBgr ? 2 : 0;
+	const int blueIndex = isBgr ? 0 : 2;
+	forEachBand(image.rows, statistics, [&](int band, int y) {
+		const uchar* pixels = image.ptr(y);
+		uchar* hsvRow = hsv.ptr(y);
+		for (int x = 0; x < image.cols; x++) {
+			const uchar* pixel = pixels + 3 * x;
+			rgbToHsv(pixel[redIndex], pixel[1], pixel[blueIndex], hsvRow + 3 * x);
+		}
+		if (statistics) {
+			statistics->accumulateRow(band, y, hsvRow, image.cols);
+		}
+	});
+}
+
+
+uint64_t kop::refineMaskBoundary(
+	const cv::Mat& image, bool isBgr, const cv::Mat& boundary,
+	const cv::Scalar& lower, const cv::Scalar& upper, cv::Mat& mask
+) {
+	CV_Assert(image.type() == CV_8UC3 && boundary.type() == CV_8UC1);
+	CV_Assert(image.size() == boundary.size() && image.size() == mask.size());
+	std::array<int, 3> lowerBound = {};
+	std::array<int, 3> upperBound = {};
+	for (int i = 0; i < 3; i++) {
+		lowerBound[i] = cvRound(lower[i]);
+		upperBound[i] = cvRound(upper[i]);
+	}
+	const int redIndex = isBgr ? 2 : 0;
+	const int blueIndex = isBgr ? 0 : 2;
+	std::atomic<uint64_t> numRefined = 0;
+	cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& rows) {
+		uint64_t rowsRefined = 0;
+		for (int y = rows.start; y < rows.end; y++) {
+			const uchar* pixels = image.ptr(y);
+			const uchar* band = boundary.ptr(y);
+			uchar* maskRow = mask.ptr(y);
+			for (int x = 0; x < image.cols; x++) {
+				if (band[x] == 0) {
+					continue;
+				}
+				const uchar* pixel = pixels + 3 * x;
+				uchar hsv[3] = {};
+				rgbToHsv(pixel[redIndex], pixel[1], pixel[blueIndex], hsv);
+				bool isInside = true;
+				for (int i = 0; i < 3; i++) {
+					isInside = isInside &&
+						hsv[i] >= lowerBound[i] && hsv[i] <= upperBound[i];
+				}
+				maskRow[x] = isInside ? 255 : 0;
+				rowsRefined += 1;
+			}
+		}
+		numRefined += rowsRefined;
+	});
+	return numRefined;
+}
\ No newline at end of file
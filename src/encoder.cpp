@@ -0,0 +1,213 @@
+#include "encoder.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace kop;
+
+
+namespace {
+
+	bool hasRawExtension(const std::string& path) {
+		const std::string extension = ".raw";
+		return path.size() >= extension.size() &&
+			path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+	}
+
+}
+
+
+FrameEncoder::~FrameEncoder() {
+	this->close();
+}
+
+
+bool FrameEncoder::open(
+	const std::string& path, int width, int height, double fps,
+	size_t queueSize, DropPolicy policy
+) {
+	this->close();
+	this->isRaw = hasRawExtension(path);
+	if (this->isRaw) {
+		this->rawFile.open(path, std::ios::binary);
+	}
+	else {
+		this->writer.open(
+			path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'),
+			fps, { width, height }, true
+		);
+	}
+	if (!this->rawFile.is_open() && !this->writer.isOpened()) {
+		return false;
+	}
+	this->width = width;
+	this->height = height;
+	this->fps = fps;
+	this->writtenFrames = 0;
+	this->policy = policy;
+	this->slots.assign(std::max(queueSize, size_t(2)), cv::Mat());
+	this->slotTimes.assign(this->slots.size(), std::chrono::steady_clock::time_point());
+	this->freeSlots.clear();
+	for (size_t i = 0; i < this->slots.size(); i++) {
+		this->slots[i].create(height, width, CV_8UC4);
+		this->freeSlots.push_back(i);
+	}
+	this->queue.clear();
+	this->stats = EncoderStats();
+	this->stopping = false;
+	this->worker = std::thread(&FrameEncoder::encoderThread, this);
+	return true;
+}
+
+
+void FrameEncoder::close() {
+	if (!this->worker.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->locker);
+		this->stopping = true;
+	}
+	this->queueSignal.notify_all();
+	this->worker.join();
+	this->writer.release();
+	if (this->rawFile.is_open()) {
+		this->rawFile.close();
+	}
+}
+
+
+bool FrameEncoder::isOpen() const {
+	return this->worker.joinable();
+}
+
+
+bool FrameEncoder::submit(
+	const void* pixels, size_t step,
+	std::chrono::steady_clock::time_point timestamp
+) {
+	size_t index = 0;
+	{
+		std::lock_guard<std::mutex> lock(this->locker);
+		if (!this->worker.joinable()) {
+			return false;
+		}
+		this->stats.submitted += 1;
+		if (!this->freeSlots.empty()) {
+			index = this->freeSlots.back();
+			this->freeSlots.pop_back();
+		}
+		else if (this->policy == DropPolicy::DropOldest && !this->queue.empty()) {
+			index = this->queue.front();
+			this->queue.pop_front();
+			this->stats.dropped += 1;
+		}
+		else {
+			this->stats.dropped += 1;
+			return false;
+		}
+	}
+	cv::Mat& slot = this->slots[index];
+	const unsigned char* source = static_cast<const unsigned char*>(pixels);
+	const size_t rowBytes = static_cast<size_t>(this->width) * 4;
+	for (int y = 0; y < this->height; y++) {
+		std::memcpy(slot.ptr(y), source + y * step, rowBytes);
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->locker);
+		this->slotTimes[index] = timestamp;
+		this->queue.push_back(index);
+	}
+	this->queueSignal.notify_one();
+	return true;
+}
+
+
+EncoderStats FrameEncoder::getStats() const {
+	std::lock_guard<std::mutex> lock(this->locker);
+	EncoderStats current = this->stats;
+	current.queued = this->queue.size();
+	return current;
+}
+
+
+void FrameEncoder::encoderThread() {
+	while (true) {
+		size_t index = 0;
+		std::chrono::steady_clock::time_point timestamp;
+		{
+			std::unique_lock<std::mutex> lock(this->locker);
+			this->queueSignal.wait(lock, [&]() {
+				return this->stopping || !this->queue.empty();
+			});
+			if (this->queue.empty()) {
+				break;
+			}
+			index = this->queue.front();
+			this->queue.pop_front();
+			timestamp = this->slotTimes[index];
+		}
+		const uint64_t repeats = this->getPacedRepeats(timestamp);
+		const auto startTime = std::chrono::steady_clock::now();
+		this->encode(this->slots[index], repeats);
+		const double millis = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - startTime
+		).count();
+		std::lock_guard<std::mutex> lock(this->locker);
+		this->freeSlots.push_back(index);
+		if (repeats == 0) {
+			this->stats.skipped += 1;
+			continue;
+		}
+		this->stats.encoded += 1;
+		this->stats.duplicated += repeats - 1;
+		this->stats.encodeMillis += FrameEncoder::statsSmoothing * (
+			millis - this->stats.encodeMillis
+		);
+	}
+}
+
+
+uint64_t FrameEncoder::getPacedRepeats(
+	std::chrono::steady_clock::time_point timestamp
+) {
+	if (this->writtenFrames == 0) {
+		this->firstTimestamp = timestamp;
+	}
+	const double elapsed = std::chrono::duration<double>(
+		timestamp - this->firstTimestamp
+	).count();
+	const uint64_t target = static_cast<uint64_t>(
+		std::max(elapsed, 0.0) * this->fps + 0.5
+	);
+	if (target < this->writtenFrames) {
+		return 0;
+	}
+	const uint64_t repeats = target - this->writtenFrames + 1;
+	this->writtenFrames += repeats;
+	return repeats;
+}
+
+
+void FrameEncoder::encode(const cv::Mat& frame, uint64_t repeats) {
+	if (repeats == 0) {
+		return;
+	}
+	if (this->isRaw) {
+		for (uint64_t i = 0; i < repeats; i++) {
+			for (int y = frame.rows - 1; y >= 0; y--) {
+				this->rawFile.write(
+					reinterpret_cast<const char*>(frame.ptr(y)),
+					static_cast<std::streamsize>(frame.cols) * 4
+				);
+			}
+		}
+		return;
+	}
+	cv::cvtColor(frame, this->converted, cv::COLOR_RGBA2BGR);
+	cv::flip(this->converted, this->converted, 0);
+	for (uint64_t i = 0; i < repeats; i++) {
+		this->writer.write(this->converted);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,644 @@
+#include "graph.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+using namespace kop;
+
+
+namespace {
+
+	constexpr const int persistentLevel = INT_MAX;
+
+
+	const std::array<std::pair<const char*, StageType>, 8> stageTypeNames = { {
+		{ "source", StageType::Source },
+		{ "temporal", StageType::Temporal },
+		{ "blur", StageType::Blur },
+		{ "convert", StageType::Convert },
+		{ "threshold", StageType::Threshold },
+		{ "morphology", StageType::Morphology },
+		{ "composite", StageType::Composite },
+		{ "output", StageType::Output },
+	} };
+
+
+	const std::array<std::pair<const char*, int>, 5> morphologyNames = { {
+		{ "open", cv::MORPH_OPEN },
+		{ "close", cv::MORPH_CLOSE },
+		{ "erode", cv::MORPH_ERODE },
+		{ "dilate", cv::MORPH_DILATE },
+		{ "gradient", cv::MORPH_GRADIENT },
+	} };
+
+
+	std::string trim(const std::string& text) {
+		const size_t first = text.find_first_not_of(" \t\r");
+		if (first == std::string::npos) {
+			return std::string();
+		}
+		const size_t last = text.find_last_not_of(" \t\r");
+		return text.substr(first, last - first + 1);
+	}
+
+
+	bool isSameName(const std::string& name, const char* other) {
+		const std::string text(other);
+		return name.size() == text.size() && std::equal(
+			name.begin(), name.end(), text.begin(),
+			[](char a, char b) { return std::tolower(a) == std::tolower(b); }
+		);
+	}
+
+
+	bool parseBound(const std::string& value, cv::Scalar& bound) {
+		static const std::array<double, 3> scales = { 180.0, 255.0, 255.0 };
+		std::stringstream ss(value);
+		std::string item;
+		for (int i = 0; i < 3; i++) {
+			if (!std::getline(ss, item, ',')) {
+				return false;
+			}
+			bound[i] = scales[i] * std::clamp(std::stod(item), 0.0, 1.0);
+		}
+		return true;
+	}
+
+}
+
+
+const cv::Scalar ProcessingGraph::nullColor = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+
+bool GraphStage::isPointwise() const {
+	return this->type == StageType::Convert ||
+		this->type == StageType::Threshold ||
+		this->type == StageType::Composite;
+}
+
+
+bool ProcessingGraph::load(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		this->loaded = false;
+		return this->fail("Cannot open " + path);
+	}
+	return this->parse(file);
+}
+
+
+bool ProcessingGraph::parse(std::istream& stream) {
+	this->stages.clear();
+	this->groups.clear();
+	this->levels.clear();
+	this->buffers.clear();
+	this->bufferTypes.clear();
+	this->scratch.clear();
+	this->loaded = false;
+	this->error.clear();
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(stream, line)) {
+		lineNumber += 1;
+		line = trim(line.substr(0, line.find('#')));
+		if (line.empty()) {
+			continue;
+		}
+		const size_t equals = line.find('=');
+		std::vector<std::string> tokens;
+		std::stringstream ss(line.substr(equals + 1));
+		std::string token;
+		while (ss >> token) {
+			tokens.push_back(token);
+		}
+		bool isAdded = false;
+		try {
+			isAdded = (equals != std::string::npos) &&
+				this->addStage(trim(line.substr(0, equals)), tokens);
+		}
+		catch (const std::exception&) {
+			this->fail("Invalid number");
+		}
+		if (!isAdded) {
+			return this->fail(
+				"Line " + std::to_string(lineNumber) + ": " +
+				(this->error.empty() ? "Expected 'name = type inputs...'" : this->error)
+			);
+		}
+	}
+	return this->compile();
+}
+
+
+void ProcessingGraph::setRange(
+	const cv::Scalar& lowerBound, const cv::Scalar& upperBound
+) {
+	this->lowerBound = lowerBound;
+	this->upperBound = upperBound;
+}
+
+
+bool ProcessingGraph::run(const cv::Mat& source, bool isBgr) {
+	if (!this->loaded || source.empty() || source.type() != CV_8UC3) {
+		return false;
+	}
+	this->sourceFrame = source;
+	this->allocateBuffers(source.size());
+	for (const std::vector<int>& level : this->levels) {
+		if (level.size() == 1) {
+			this->runGroup(this->groups[level.front()], isBgr);
+			continue;
+		}
+		cv::parallel_for_(cv::Range(0, static_cast<int>(level.size())), [&](const cv::Range& range) {
+			for (int i = range.start; i < range.end; i++) {
+				this->runGroup(this->groups[level[i]], isBgr);
+			}
+		});
+	}
+	this->sourceFrame.release();
+	return true;
+}
+
+
+bool ProcessingGraph::isLoaded() const {
+	return this->loaded;
+}
+
+
+bool ProcessingGraph::hasOutput(const std::string& name, int type) const {
+	const int index = this->findStage(name);
+	return index >= 0 &&
+		this->stages[index].type == StageType::Output &&
+		this->stages[index].outputType == type;
+}
+
+
+bool ProcessingGraph::requireOutput(const std::string& name, int type) {
+	if (this->hasOutput(name, type)) {
+		return true;
+	}
+	return this->fail("Graph needs an output named '" + name + "'");
+}
+
+
+const cv::Mat& ProcessingGraph::getOutput(const std::string& name) const {
+	static const cv::Mat empty;
+	const int index = this->findStage(name);
+	if (index < 0 || this->stages[index].type != StageType::Output) {
+		return empty;
+	}
+	return this->getStageImage(this->stages[index].inputs.front());
+}
+
+
+const std::string& ProcessingGraph::getError() const {
+	return this->error;
+}
+
+
+size_t ProcessingGraph::getNumStages() const {
+	return this->stages.size();
+}
+
+
+size_t ProcessingGraph::getNumGroups() const {
+	return this->groups.size();
+}
+
+
+size_t ProcessingGraph::getNumLevels() const {
+	return this->levels.size();
+}
+
+
+size_t ProcessingGraph::getNumBuffers() const {
+	return this->bufferTypes.size();
+}
+
+
+std::string ProcessingGraph::describeSchedule() const {
+	std::stringstream ss;
+	for (size_t level = 0; level < this->levels.size(); level++) {
+		ss << (level == 0 ? "" : "\n") << 'L' << level << ':';
+		for (size_t i = 0; i < this->levels[level].size(); i++) {
+			const GraphGroup& group = this->groups[this->levels[level][i]];
+			ss << (i == 0 ? " " : " | ");
+			for (size_t j = 0; j < group.stages.size(); j++) {
+				ss << (j == 0 ? "" : "+") << this->stages[group.stages[j]].name;
+			}
+		}
+	}
+	return ss.str();
+}
+
+
+bool ProcessingGraph::addStage(
+	const std::string& name, const std::vector<std::string>& tokens
+) {
+	if (name.empty() || tokens.empty()) {
+		return this->fail("Expected 'name = type inputs...'");
+	}
+	if (this->findStage(name) >= 0) {
+		return this->fail("Stage '" + name + "' is defined twice");
+	}
+	GraphStage stage;
+	stage.name = name;
+	const auto typeName = std::find_if(
+		stageTypeNames.begin(), stageTypeNames.end(),
+		[&](const auto& entry) { return isSameName(tokens.front(), entry.first); }
+	);
+	if (typeName == stageTypeNames.end()) {
+		return this->fail("Unknown stage type '" + tokens.front() + "'");
+	}
+	stage.type = typeName->second;
+	for (size_t i = 1; i < tokens.size(); i++) {
+		const size_t equals = tokens[i].find('=');
+		if (equals != std::string::npos) {
+			const std::string key = tokens[i].substr(0, equals);
+			if (!this->setParameter(stage, key, tokens[i].substr(equals + 1))) {
+				return this->fail("Invalid parameter '" + tokens[i] + "' for '" + name + "'");
+			}
+			continue;
+		}
+		const int input = this->findStage(tokens[i]);
+		if (input < 0) {
+			return this->fail("Stage '" + tokens[i] + "' is not defined before '" + name + "'");
+		}
+		stage.inputs.push_back(input);
+	}
+
+	const size_t numInputs = (stage.type == StageType::Source)
+		? 0
+		: (stage.type == StageType::Composite) ? 2 : 1;
+	if (stage.inputs.size() != numInputs) {
+		return this->fail(
+			"Stage '" + name + "' expects " + std::to_string(numInputs) + " input(s)"
+		);
+	}
+	const int inputType = (numInputs > 0)
+		? this->stages[stage.inputs.front()].outputType
+		: -1;
+	if (stage.type == StageType::Source) {
+		for (const GraphStage& other : this->stages) {
+			if (other.type == StageType::Source) {
+				return this->fail("Only one source stage is supported");
+			}
+		}
+		stage.outputType = CV_8UC3;
+	}
+	else if (stage.type == StageType::Convert || stage.type == StageType::Threshold) {
+		if (inputType != CV_8UC3) {
+			return this->fail("Stage '" + name + "' needs a three-channel input");
+		}
+		if (stage.type == StageType::Threshold) {
+			stage.outputType = CV_8UC1;
+		}
+		else if (stage.rgbCode < 0) {
+			return this->fail("Stage '" + name + "' needs to=hsv, to=rgba or to=gray");
+		}
+	}
+	else if (stage.type == StageType::Composite) {
+		if (this->stages[stage.inputs.back()].outputType != CV_8UC1) {
+			return this->fail("Stage '" + name + "' needs a mask as its second input");
+		}
+		stage.outputType = inputType;
+	}
+	else if (stage.type == StageType::Output) {
+		if (this->stages[stage.inputs.front()].type == StageType::Source) {
+			return this->fail("Output '" + name + "' cannot expose the source directly");
+		}
+		stage.outputType = inputType;
+	}
+	else {
+		stage.outputType = inputType;
+	}
+	if (stage.type == StageType::Morphology) {
+		stage.morphology = (stage.morphology < 0) ? cv::MORPH_OPEN : stage.morphology;
+		stage.kernel = cv::getStructuringElement(
+			cv::MORPH_ELLIPSE, { 2 * stage.radius + 1, 2 * stage.radius + 1 }
+		);
+	}
+	for (const int input : stage.inputs) {
+		this->stages[input].consumers += 1;
+	}
+	this->stages.push_back(stage);
+	return true;
+}
+
+
+bool ProcessingGraph::setParameter(
+	GraphStage& stage, const std::string& key, const std::string& value
+) {
+	if (stage.type == StageType::Temporal && key == "decay") {
+		stage.decay = std::clamp(std::stof(value), 0.0f, 1.0f);
+		return true;
+	}
+	if ((stage.type == StageType::Blur || stage.type == StageType::Morphology) && key == "radius") {
+		stage.radius = std::clamp(std::stoi(value), 0, 15);
+		return true;
+	}
+	if (stage.type == StageType::Blur && key == "type") {
+		for (size_t i = 0; i < numBlurTypes; i++) {
+			if (isSameName(value, getBlurTypeName(static_cast<BlurType>(i)))) {
+				stage.blurType = static_cast<BlurType>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+	if (stage.type == StageType::Convert && key == "to") {
+		if (value == "hsv") {
+			stage.rgbCode = cv::COLOR_RGB2HSV;
+			stage.bgrCode = cv::COLOR_BGR2HSV;
+			stage.outputType = CV_8UC3;
+			return true;
+		}
+		if (value == "rgba") {
+			stage.rgbCode = cv::COLOR_RGB2RGBA;
+			stage.bgrCode = cv::COLOR_BGR2RGBA;
+			stage.outputType = CV_8UC4;
+			return true;
+		}
+		if (value == "gray") {
+			stage.rgbCode = cv::COLOR_RGB2GRAY;
+			stage.bgrCode = cv::COLOR_BGR2GRAY;
+			stage.outputType = CV_8UC1;
+			return true;
+		}
+		return false;
+	}
+	if (stage.type == StageType::Threshold && (key == "lower" || key == "upper")) {
+		stage.hasRange = true;
+		return parseBound(value, (key == "lower") ? stage.lowerBound : stage.upperBound);
+	}
+	if (stage.type == StageType::Morphology && key == "op") {
+		for (const auto& entry : morphologyNames) {
+			if (value == entry.first) {
+				stage.morphology = entry.second;
+				return true;
+			}
+		}
+		return false;
+	}
+	return false;
+}
+
+
+bool ProcessingGraph::compile() {
+	bool hasSource = false;
+	bool hasOutput = false;
+	for (const GraphStage& stage : this->stages) {
+		hasSource = hasSource || stage.type == StageType::Source;
+		hasOutput = hasOutput || stage.type == StageType::Output;
+		if (stage.consumers == 0 && stage.type != StageType::Output) {
+			return this->fail("Stage '" + stage.name + "' is never used");
+		}
+	}
+	if (!hasSource || !hasOutput) {
+		return this->fail("Graph needs a source and at least one output");
+	}
+	this->fuseStages();
+	this->assignBuffers();
+	this->loaded = true;
+	return true;
+}
+
+
+void ProcessingGraph::fuseStages() {
+	int numLevels = 0;
+	for (int index = 0; index < static_cast<int>(this->stages.size()); index++) {
+		GraphStage& stage = this->stages[index];
+		if (stage.type == StageType::Source || stage.type == StageType::Output) {
+			continue;
+		}
+		int groupIndex = -1;
+		if (stage.isPointwise()) {
+			for (const int input : stage.inputs) {
+				const GraphStage& producer = this->stages[input];
+				if (producer.isPointwise() && producer.consumers == 1) {
+					groupIndex = producer.group;
+					break;
+				}
+			}
+		}
+		if (groupIndex < 0) {
+			groupIndex = static_cast<int>(this->groups.size());
+			this->groups.emplace_back();
+		}
+		stage.group = groupIndex;
+		GraphGroup& group = this->groups[groupIndex];
+		group.stages.push_back(index);
+		for (const int input : stage.inputs) {
+			const int inputGroup = this->stages[input].group;
+			if (inputGroup >= 0 && inputGroup != groupIndex) {
+				group.level = std::max(group.level, this->groups[inputGroup].level + 1);
+			}
+		}
+		numLevels = std::max(numLevels, group.level + 1);
+	}
+	this->levels.assign(numLevels, std::vector<int>());
+	for (size_t i = 0; i < this->groups.size(); i++) {
+		this->levels[this->groups[i].level].push_back(static_cast<int>(i));
+	}
+}
+
+
+void ProcessingGraph::assignBuffers() {
+	for (const GraphStage& stage : this->stages) {
+		const int level = (stage.type == StageType::Output)
+			? persistentLevel
+			: (stage.group >= 0) ? this->groups[stage.group].level : 0;
+		for (const int input : stage.inputs) {
+			GraphStage& producer = this->stages[input];
+			if (producer.group != stage.group || stage.group < 0) {
+				producer.lastLevel = std::max(producer.lastLevel, level);
+			}
+		}
+	}
+	for (GraphStage& stage : this->stages) {
+		if (stage.type == StageType::Temporal) {
+			stage.lastLevel = persistentLevel;
+		}
+	}
+	std::vector<int> freeBuffers;
+	std::vector<int> liveStages;
+	for (int level = 0; level < static_cast<int>(this->levels.size()); level++) {
+		for (auto it = liveStages.begin(); it != liveStages.end();) {
+			if (this->stages[*it].lastLevel < level) {
+				freeBuffers.push_back(this->stages[*it].buffer);
+				it = liveStages.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+		for (const int groupIndex : this->levels[level]) {
+			const int tail = this->groups[groupIndex].stages.back();
+			GraphStage& stage = this->stages[tail];
+			if (stage.lastLevel == persistentLevel) {
+				stage.buffer = static_cast<int>(this->bufferTypes.size());
+				this->bufferTypes.push_back(stage.outputType);
+				continue;
+			}
+			const auto reusable = std::find_if(
+				freeBuffers.begin(), freeBuffers.end(),
+				[&](int buffer) { return this->bufferTypes[buffer] == stage.outputType; }
+			);
+			if (reusable != freeBuffers.end()) {
+				stage.buffer = *reusable;
+				freeBuffers.erase(reusable);
+			}
+			else {
+				stage.buffer = static_cast<int>(this->bufferTypes.size());
+				this->bufferTypes.push_back(stage.outputType);
+			}
+			liveStages.push_back(tail);
+		}
+	}
+	this->buffers.assign(this->bufferTypes.size(), cv::Mat());
+	this->scratch.assign(this->stages.size(), cv::Mat());
+}
+
+
+void ProcessingGraph::allocateBuffers(const cv::Size& size) {
+	bool isResized = false;
+	for (size_t i = 0; i < this->buffers.size(); i++) {
+		if (this->buffers[i].size() != size) {
+			this->buffers[i].allocator = cv::Mat::getStdAllocator();
+			this->buffers[i].create(size, this->bufferTypes[i]);
+			isResized = true;
+		}
+	}
+	if (!isResized) {
+		return;
+	}
+	for (size_t i = 0; i < this->stages.size(); i++) {
+		GraphStage& stage = this->stages[i];
+		stage.isPrimed = false;
+		if (stage.group >= 0 && stage.buffer < 0) {
+			this->scratch[i].allocator = cv::Mat::getStdAllocator();
+			this->scratch[i].create(ProcessingGraph::numBands, size.width, stage.outputType);
+		}
+	}
+}
+
+
+void ProcessingGraph::runGroup(const GraphGroup& group, bool isBgr) {
+	GraphStage& head = this->stages[group.stages.front()];
+	if (!head.isPointwise()) {
+		this->runStage(head);
+		return;
+	}
+	const int height = this->sourceFrame.rows;
+	cv::parallel_for_(cv::Range(0, ProcessingGraph::numBands), [&](const cv::Range& bands) {
+		for (int band = bands.start; band < bands.end; band++) {
+			const int begin = height * band / ProcessingGraph::numBands;
+			const int end = height * (band + 1) / ProcessingGraph::numBands;
+			for (int y = begin; y < end; y++) {
+				for (const int index : group.stages) {
+					const GraphStage& stage = this->stages[index];
+					std::array<cv::Mat, 2> inputs = {};
+					for (size_t i = 0; i < stage.inputs.size(); i++) {
+						inputs[i] = this->getStageRow(stage.inputs[i], band, y);
+					}
+					cv::Mat output = this->getStageRow(index, band, y);
+					this->runStageRow(stage, inputs, output, isBgr);
+				}
+			}
+		}
+	});
+}
+
+
+void ProcessingGraph::runStage(GraphStage& stage) {
+	const cv::Mat& input = this->getStageImage(stage.inputs.front());
+	cv::Mat& output = this->buffers[stage.buffer];
+	switch (stage.type) {
+	case StageType::Temporal:
+		if (!stage.isPrimed) {
+			input.copyTo(output);
+			stage.isPrimed = true;
+			break;
+		}
+		cv::addWeighted(input, 1.0 - stage.decay, output, stage.decay, 0.0, output);
+		break;
+	case StageType::Blur:
+		if (stage.radius == 0) {
+			input.copyTo(output);
+			break;
+		}
+		blurImage(input, output, stage.blurType, stage.radius);
+		break;
+	case StageType::Morphology:
+		cv::morphologyEx(input, output, stage.morphology, stage.kernel);
+		break;
+	default:
+		break;
+	}
+}
+
+
+void ProcessingGraph::runStageRow(
+	const GraphStage& stage, const std::array<cv::Mat, 2>& inputs,
+	cv::Mat& output, bool isBgr
+) const {
+	switch (stage.type) {
+	case StageType::Convert:
+		cv::cvtColor(inputs[0], output, isBgr ? stage.bgrCode : stage.rgbCode);
+		break;
+	case StageType::Threshold:
+		cv::inRange(
+			inputs[0],
+			stage.hasRange ? stage.lowerBound : this->lowerBound,
+			stage.hasRange ? stage.upperBound : this->upperBound,
+			output
+		);
+		break;
+	case StageType::Composite:
+		output.setTo(ProcessingGraph::nullColor);
+		inputs[0].copyTo(output, inputs[1]);
+		break;
+	default:
+		break;
+	}
+}
+
+
+const cv::Mat& ProcessingGraph::getStageImage(int index) const {
+	const GraphStage& stage = this->stages[index];
+	if (stage.type == StageType::Source) {
+		return this->sourceFrame;
+	}
+	return this->buffers[stage.buffer];
+}
+
+
+cv::Mat ProcessingGraph::getStageRow(int index, int band, int y) const {
+	const GraphStage& stage = this->stages[index];
+	if (stage.buffer < 0 && stage.type != StageType::Source) {
+		const cv::Mat& rows = this->scratch[index];
+		return cv::Mat(1, rows.cols, rows.type(), const_cast<uchar*>(rows.ptr(band)));
+	}
+	const cv::Mat& image = this->getStageImage(index);
+	return cv::Mat(1, image.cols, image.type(), const_cast<uchar*>(image.ptr(y)));
+}
+
+
+int ProcessingGraph::findStage(const std::string& name) const {
+	for (size_t i = 0; i < this->stages.size(); i++) {
+		if (this->stages[i].name == name) {
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+
+bool ProcessingGraph::fail(const std::string& message) {
+	this->error = message;
+	return false;
+}
\ No newline at end of file
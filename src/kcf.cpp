@@ -0,0 +1,254 @@
+#define KCF_BUILD
+#include "kcf.h"
+#include "kernels.h"
+#include "processor.h"
+#include <algorithm>
+#include <exception>
+#include <string>
+
+using namespace kop;
+
+
+struct kcf_processor {
+public:
+	Processor processor;
+	ProcessingGraph graph;
+	mutable std::string error;
+};
+
+
+namespace {
+
+	int fail(const kcf_processor* processor, const std::string& message) {
+		processor->error = message;
+		return -1;
+	}
+
+
+	bool wrapFrame(const kcf_frame& frame, cv::Mat& image, std::string& error) {
+		if (!frame.data || frame.width <= 0 || frame.height <= 0) {
+			error = "empty frame";
+			return false;
+		}
+		int rows = frame.height;
+		int type = CV_8UC3;
+		switch (frame.format) {
+		case KCF_FORMAT_BGR:
+		case KCF_FORMAT_RGB:
+			break;
+		case KCF_FORMAT_YUYV:
+			type = CV_8UC2;
+			break;
+		case KCF_FORMAT_NV12:
+			rows = frame.height * 3 / 2;
+			type = CV_8UC1;
+			break;
+		default:
+			error = "unknown pixel format " + std::to_string(frame.format);
+			return false;
+		}
+		const bool isYuv = frame.format == KCF_FORMAT_YUYV ||
+			frame.format == KCF_FORMAT_NV12;
+		if (isYuv && (frame.width % 2 != 0 || frame.height % 2 != 0)) {
+			error = "YUV frames need an even width and height";
+			return false;
+		}
+		const size_t rowBytes = static_cast<size_t>(frame.width) * CV_ELEM_SIZE(type);
+		if (frame.stride < 0 || static_cast<size_t>(frame.stride) < rowBytes) {
+			error = "stride " + std::to_string(frame.stride) + " is shorter than a row";
+			return false;
+		}
+		image = cv::Mat(
+			rows, frame.width, type,
+			const_cast<uint8_t*>(frame.data), static_cast<size_t>(frame.stride)
+		);
+		return true;
+	}
+
+
+	int exportImage(const kcf_processor* processor, const cv::Mat& image, kcf_image* output) {
+		if (!output) {
+			return fail(processor, "no output image");
+		}
+		if (image.empty()) {
+			return fail(processor, "no frame has been processed");
+		}
+		output->data = image.data;
+		output->width = image.cols;
+		output->height = image.rows;
+		output->stride = static_cast<int32_t>(image.step);
+		output->channels = image.channels();
+		return 0;
+	}
+
+}
+
+
+uint32_t kcf_version(void) {
+	return KCF_VERSION;
+}
+
+
+const char* kcf_cpu_level(void) {
+	return getCpuLevelName(getCpuLevel());
+}
+
+
+kcf_processor* kcf_create(void) {
+	try {
+		kcf_processor* processor = new kcf_processor();
+		processor->processor.setRange({ 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });
+		return processor;
+	}
+	catch (const std::exception&) {
+		return nullptr;
+	}
+}
+
+
+void kcf_destroy(kcf_processor* processor) {
+	delete processor;
+}
+
+
+int kcf_set_range(kcf_processor* processor, const float lower[3], const float upper[3]) {
+	if (!processor || !lower || !upper) {
+		return -1;
+	}
+	processor->processor.setRange(
+		{ lower[0], lower[1], lower[2] }, { upper[0], upper[1], upper[2] }
+	);
+	return 0;
+}
+
+
+int kcf_set_blur(kcf_processor* processor, int32_t type, int32_t size) {
+	if (!processor) {
+		return -1;
+	}
+	if (type < 0 || static_cast<size_t>(type) >= numBlurTypes) {
+		return fail(processor, "unknown blur type " + std::to_string(type));
+	}
+	if (size < 0 || size > Processor::maxBlurSize) {
+		return fail(
+			processor, "blur size " + std::to_string(size) + " is outside 0.." +
+			std::to_string(Processor::maxBlurSize)
+		);
+	}
+	processor->processor.setBlurType(static_cast<BlurType>(type));
+	processor->processor.setBlurSize(size);
+	return 0;
+}
+
+
+int kcf_set_blobs(kcf_processor* processor, int enabled, uint64_t min_area) {
+	if (!processor) {
+		return -1;
+	}
+	processor->processor.setBlobOptions(enabled != 0, min_area);
+	return 0;
+}
+
+
+int kcf_load_graph(kcf_processor* processor, const char* path) {
+	if (!processor) {
+		return -1;
+	}
+	processor->processor.setGraph(nullptr);
+	if (!path || !*path) {
+		return 0;
+	}
+	try {
+		if (
+			!processor->graph.load(path) ||
+			!processor->processor.setGraph(&processor->graph)
+		) {
+			return fail(processor, processor->graph.getError());
+		}
+	}
+	catch (const std::exception& exception) {
+		return fail(processor, exception.what());
+	}
+	return 0;
+}
+
+
+int kcf_process(kcf_processor* processor, const kcf_frame* frame) {
+	if (!processor) {
+		return -1;
+	}
+	if (!frame) {
+		return fail(processor, "no frame");
+	}
+	cv::Mat image;
+	if (!wrapFrame(*frame, image, processor->error)) {
+		return -1;
+	}
+	try {
+		bool isProcessed = false;
+		switch (frame->format) {
+		case KCF_FORMAT_RGB:
+			isProcessed = processor->processor.processRgb(image, false);
+			break;
+		case KCF_FORMAT_YUYV:
+			isProcessed = processor->processor.processNative(
+				image, PixelFormat::YUYV, false
+			);
+			break;
+		case KCF_FORMAT_NV12:
+			isProcessed = processor->processor.processNative(
+				image, PixelFormat::NV12, false
+			);
+			break;
+		default:
+			isProcessed = processor->processor.processBgr(image);
+			break;
+		}
+		if (!isProcessed) {
+			return fail(processor, "frame was not processed");
+		}
+	}
+	catch (const std::exception& exception) {
+		return fail(processor, exception.what());
+	}
+	processor->error.clear();
+	return 0;
+}
+
+
+int kcf_get_mask(const kcf_processor* processor, kcf_image* mask) {
+	return processor ? exportImage(processor, processor->processor.getMask(), mask) : -1;
+}
+
+
+int kcf_get_filtered(const kcf_processor* processor, kcf_image* filtered) {
+	return processor
+		? exportImage(processor, processor->processor.getFilteredFrame(), filtered)
+		: -1;
+}
+
+
+size_t kcf_get_blobs(const kcf_processor* processor, kcf_blob* blobs, size_t capacity) {
+	if (!processor) {
+		return 0;
+	}
+	const std::vector<Blob>& found = processor->processor.getBlobs();
+	const size_t count = blobs ? std::min(capacity, found.size()) : 0;
+	for (size_t i = 0; i < count; i++) {
+		const Blob& blob = found[i];
+		blobs[i].area = blob.area;
+		blobs[i].x = blob.boundingBox.x;
+		blobs[i].y = blob.boundingBox.y;
+		blobs[i].width = blob.boundingBox.width;
+		blobs[i].height = blob.boundingBox.height;
+		blobs[i].centroid_x = blob.centroid.x;
+		blobs[i].centroid_y = blob.centroid.y;
+		blobs[i].orientation = blob.getOrientation();
+	}
+	return found.size();
+}
+
+
+const char* kcf_last_error(const kcf_processor* processor) {
+	return processor ? processor->error.c_str() : "no processor";
+}
\ No newline at end of file
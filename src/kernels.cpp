@@ -0,0 +1,116 @@
+#include "kernels.h"
+#include "kernel_loops.h"
+
+#if defined(_MSC_VER) && defined(KOP_CPU_DISPATCH)
+#include <intrin.h>
+#endif
+
+using namespace kop;
+
+
+namespace {
+
+#if defined(_MSC_VER) && defined(KOP_CPU_DISPATCH)
+	CpuLevel detectCpuid() {
+		int info[4] = {};
+		__cpuid(info, 0);
+		const int maxLeaf = info[0];
+		__cpuid(info, 1);
+		const bool hasSse41 = (info[2] & (1 << 19)) != 0;
+		const bool hasFma = (info[2] & (1 << 12)) != 0;
+		const bool hasOsSave = (info[2] & (1 << 27)) != 0;
+		const bool hasAvx = (info[2] & (1 << 28)) != 0;
+		if (!hasSse41) {
+			return CpuLevel::Baseline;
+		}
+		if (!hasOsSave || !hasAvx || maxLeaf < 7) {
+			return CpuLevel::Sse41;
+		}
+		const unsigned long long xcr0 = _xgetbv(0);
+		if ((xcr0 & 0x6) != 0x6) {
+			return CpuLevel::Sse41;
+		}
+		__cpuidex(info, 7, 0);
+		const bool hasAvx2 = (info[1] & (1 << 5)) != 0;
+		const bool hasAvx512f = (info[1] & (1 << 16)) != 0;
+		const bool hasAvx512bw = (info[1] & (1 << 30)) != 0;
+		if (!hasAvx2 || !hasFma) {
+			return CpuLevel::Sse41;
+		}
+		if (hasAvx512f && hasAvx512bw && (xcr0 & 0xE6) == 0xE6) {
+			return CpuLevel::Avx512;
+		}
+		return CpuLevel::Avx2;
+	}
+#endif
+
+
+	BlurKernels selectBlurKernels(CpuLevel level) {
+#if defined(KOP_CPU_DISPATCH)
+		switch (level) {
+		case CpuLevel::Avx512:
+			return getAvx512BlurKernels();
+		case CpuLevel::Avx2:
+			return getAvx2BlurKernels();
+		case CpuLevel::Sse41:
+			return getSse41BlurKernels();
+		default:
+			break;
+		}
+#endif
+		return getBaselineBlurKernels();
+	}
+
+}
+
+
+CpuLevel kop::detectCpuLevel() {
+#if defined(_MSC_VER) && defined(KOP_CPU_DISPATCH)
+	return detectCpuid();
+#elif defined(__GNUC__) && defined(KOP_CPU_DISPATCH)
+	__builtin_cpu_init();
+	if (!__builtin_cpu_supports("sse4.1")) {
+		return CpuLevel::Baseline;
+	}
+	if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma")) {
+		return CpuLevel::Sse41;
+	}
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+		return CpuLevel::Avx512;
+	}
+	return CpuLevel::Avx2;
+#else
+	return CpuLevel::Baseline;
+#endif
+}
+
+
+const char* kop::getCpuLevelName(CpuLevel level) {
+	switch (level) {
+	case CpuLevel::Sse41:
+		return "SSE4.1";
+	case CpuLevel::Avx2:
+		return "AVX2";
+	case CpuLevel::Avx512:
+		return "AVX-512";
+	default:
+		return "Baseline";
+	}
+}
+
+
+CpuLevel kop::getCpuLevel() {
+	static const CpuLevel level = detectCpuLevel();
+	return level;
+}
+
+
+const BlurKernels& kop::getBlurKernels() {
+	static const BlurKernels kernels = selectBlurKernels(getCpuLevel());
+	return kernels;
+}
+
+
+BlurKernels kop::getBaselineBlurKernels() {
+	return makeBlurKernels();
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#include "kernels.h"
+
+#if defined(KOP_CPU_DISPATCH)
+#include "kernel_loops.h"
+
+
+kop::BlurKernels kop::getSse41BlurKernels() {
+	return makeBlurKernels();
+}
+#endif
\ No newline at end of file
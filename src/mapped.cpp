@@ -0,0 +1,206 @@
+#include "mapped.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace kop;
+
+
+MappedFile::~MappedFile() {
+	this->close();
+}
+
+
+bool MappedFile::create(const std::string& path, size_t size) {
+	this->close();
+#if defined(_WIN32)
+	HANDLE handle = CreateFileA(
+		path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+		nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr
+	);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	this->file = handle;
+#else
+	this->file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (this->file < 0) {
+		return false;
+	}
+#endif
+	this->writable = true;
+	if (!this->resize(size)) {
+		this->close();
+		return false;
+	}
+	return true;
+}
+
+
+bool MappedFile::open(const std::string& path) {
+	this->close();
+#if defined(_WIN32)
+	HANDLE handle = CreateFileA(
+		path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+	);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	this->file = handle;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize)) {
+		this->close();
+		return false;
+	}
+	this->size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	this->file = ::open(path.c_str(), O_RDONLY);
+	if (this->file < 0) {
+		return false;
+	}
+	struct stat status;
+	if (fstat(this->file, &status) != 0) {
+		this->close();
+		return false;
+	}
+	this->size = static_cast<size_t>(status.st_size);
+#endif
+	this->writable = false;
+	if (this->size == 0 || !this->map()) {
+		this->close();
+		return false;
+	}
+	return true;
+}
+
+
+bool MappedFile::resize(size_t size) {
+	if (!this->isOpen() || !this->writable) {
+		return false;
+	}
+	this->unmap();
+#if defined(_WIN32)
+	LARGE_INTEGER fileSize;
+	fileSize.QuadPart = static_cast<LONGLONG>(size);
+	if (!SetFilePointerEx(this->file, fileSize, nullptr, FILE_BEGIN) ||
+		!SetEndOfFile(this->file)) {
+		return false;
+	}
+#else
+	if (ftruncate(this->file, static_cast<off_t>(size)) != 0) {
+		return false;
+	}
+#endif
+	this->size = size;
+	return size == 0 || this->map();
+}
+
+
+void MappedFile::close() {
+	this->unmap();
+#if defined(_WIN32)
+	if (this->file) {
+		CloseHandle(this->file);
+		this->file = nullptr;
+	}
+#else
+	if (this->file >= 0) {
+		::close(this->file);
+		this->file = -1;
+	}
+#endif
+	this->size = 0;
+	this->writable = false;
+}
+
+
+void MappedFile::adviseSequential() const {
+#if !defined(_WIN32)
+	if (this->data) {
+		madvise(this->data, this->size, MADV_SEQUENTIAL);
+		madvise(this->data, this->size, MADV_WILLNEED);
+	}
+#endif
+}
+
+
+bool MappedFile::isOpen() const {
+#if defined(_WIN32)
+	return this->file != nullptr;
+#else
+	return this->file >= 0;
+#endif
+}
+
+
+bool MappedFile::isWritable() const {
+	return this->writable;
+}
+
+
+unsigned char* MappedFile::getData() const {
+	return this->data;
+}
+
+
+size_t MappedFile::getSize() const {
+	return this->size;
+}
+
+
+bool MappedFile::map() {
+#if defined(_WIN32)
+	const ULONGLONG mappingSize = static_cast<ULONGLONG>(this->size);
+	this->mapping = CreateFileMappingA(
+		this->file, nullptr, this->writable ? PAGE_READWRITE : PAGE_READONLY,
+		static_cast<DWORD>(mappingSize >> 32),
+		static_cast<DWORD>(mappingSize & 0xFFFFFFFFull), nullptr
+	);
+	if (!this->mapping) {
+		return false;
+	}
+	this->data = static_cast<unsigned char*>(MapViewOfFile(
+		this->mapping, this->writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+		0, 0, this->size
+	));
+	if (!this->data) {
+		CloseHandle(this->mapping);
+		this->mapping = nullptr;
+		return false;
+	}
+#else
+	void* mapped = mmap(
+		nullptr, this->size,
+		this->writable ? PROT_READ | PROT_WRITE : PROT_READ,
+		MAP_SHARED, this->file, 0
+	);
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+	this->data = static_cast<unsigned char*>(mapped);
+#endif
+	return true;
+}
+
+
+void MappedFile::unmap() {
+	if (!this->data) {
+		return;
+	}
+#if defined(_WIN32)
+	UnmapViewOfFile(this->data);
+	CloseHandle(this->mapping);
+	this->mapping = nullptr;
+#else
+	munmap(this->data, this->size);
+#endif
+	this->data = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,438 @@
+#include "mask.h"
+#include "kernels.h"
+#include <algorithm>
+#include <istream>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KOP_MASK_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define KOP_TARGET_AVX2
+#else
+#define KOP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using namespace kop;
+
+
+namespace {
+
+	const uint32_t rleMagic = 0x454C524B;
+
+
+	inline int countTrailingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanForward64(&index, value);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+
+	inline int countLeadingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanReverse64(&index, value);
+		return 63 - static_cast<int>(index);
+#else
+		return __builtin_clzll(value);
+#endif
+	}
+
+
+	inline uint64_t countBits(uint64_t value) {
+#if defined(_MSC_VER)
+		value = value - ((value >> 1) & 0x5555555555555555ull);
+		value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+		value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+		return (value * 0x0101010101010101ull) >> 56;
+#else
+		return static_cast<uint64_t>(__builtin_popcountll(value));
+#endif
+	}
+
+
+	void packRowScalar(const uchar* src, int begin, int width, uint64_t* dst) {
+		for (int x = begin; x < width; x += 64) {
+			const int count = std::min(64, width - x);
+			uint64_t bits = 0;
+			for (int i = 0; i < count; i++) {
+				bits |= uint64_t(src[x + i] != 0) << i;
+			}
+			dst[x / 64] = bits;
+		}
+	}
+
+
+	void unpackRowScalar(const uint64_t* src, int begin, int width, uchar* dst) {
+		for (int x = begin; x < width; x++) {
+			dst[x] = ((src[x / 64] >> (x % 64)) & 1) ? 255 : 0;
+		}
+	}
+
+
+#if defined(KOP_MASK_X86)
+	KOP_TARGET_AVX2 void packRowAvx2(const uchar* src, int width, uint64_t* dst) {
+		const __m256i zero = _mm256_setzero_si256();
+		int x = 0;
+		for (; x + 64 <= width; x += 64) {
+			const __m256i low = _mm256_loadu_si256(
+				reinterpret_cast<const __m256i*>(src + x)
+			);
+			const __m256i high = _mm256_loadu_si256(
+				reinterpret_cast<const __m256i*>(src + x + 32)
+			);
+			const uint32_t lowBits = ~static_cast<uint32_t>(
+				_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, zero))
+			);
+			const uint32_t highBits = ~static_cast<uint32_t>(
+				_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, zero))
+			);
+			dst[x / 64] = uint64_t(lowBits) | (uint64_t(highBits) << 32);
+		}
+		packRowScalar(src, x, width, dst);
+	}
+
+
+	KOP_TARGET_AVX2 void unpackRowAvx2(const uint64_t* src, int width, uchar* dst) {
+		const __m256i spread = _mm256_setr_epi8(
+			0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+			2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3
+		);
+		const __m256i select = _mm256_set1_epi64x(
+			static_cast<long long>(0x8040201008040201ull)
+		);
+		int x = 0;
+		for (; x + 32 <= width; x += 32) {
+			const uint32_t bits = static_cast<uint32_t>(src[x / 64] >> (x % 64));
+			__m256i bytes = _mm256_set1_epi32(static_cast<int>(bits));
+			bytes = _mm256_shuffle_epi8(bytes, spread);
+			bytes = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, select), select);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), bytes);
+		}
+		unpackRowScalar(src, x, width, dst);
+	}
+#endif
+
+
+	void setBitRange(uint64_t* row, uint32_t begin, uint32_t end) {
+		if (begin >= end) {
+			return;
+		}
+		const size_t first = begin / 64;
+		const size_t last = (end - 1) / 64;
+		const uint64_t firstMask = ~uint64_t(0) << (begin % 64);
+		const uint64_t lastMask = ~uint64_t(0) >> (63 - (end - 1) % 64);
+		if (first == last) {
+			row[first] |= firstMask & lastMask;
+			return;
+		}
+		row[first] |= firstMask;
+		std::fill(row + first + 1, row + last, ~uint64_t(0));
+		row[last] |= lastMask;
+	}
+
+}
+
+
+PackedMask::PackedMask(int width, int height) {
+	this->create(width, height);
+}
+
+
+void PackedMask::create(int width, int height) {
+	this->width = std::max(width, 0);
+	this->height = std::max(height, 0);
+	this->rowWords = (static_cast<size_t>(this->width) + 63) / 64;
+	this->words.assign(this->rowWords * this->height, 0);
+}
+
+
+void PackedMask::pack(const cv::Mat& mask) {
+	CV_Assert(mask.type() == CV_8UC1);
+	if (mask.cols != this->width || mask.rows != this->height) {
+		this->create(mask.cols, mask.rows);
+	}
+#if defined(KOP_MASK_X86)
+	const bool useAvx2 = getCpuLevel() >= CpuLevel::Avx2;
+#endif
+	for (int y = 0; y < this->height; y++) {
+#if defined(KOP_MASK_X86)
+		if (useAvx2) {
+			packRowAvx2(mask.ptr(y), this->width, this->row(y));
+			continue;
+		}
+#endif
+		packRowScalar(mask.ptr(y), 0, this->width, this->row(y));
+	}
+}
+
+
+void PackedMask::unpack(cv::Mat& mask) const {
+	mask.create(this->height, this->width, CV_8UC1);
+#if defined(KOP_MASK_X86)
+	const bool useAvx2 = getCpuLevel() >= CpuLevel::Avx2;
+#endif
+	for (int y = 0; y < this->height; y++) {
+#if defined(KOP_MASK_X86)
+		if (useAvx2) {
+			unpackRowAvx2(this->row(y), this->width, mask.ptr(y));
+			continue;
+		}
+#endif
+		unpackRowScalar(this->row(y), 0, this->width, mask.ptr(y));
+	}
+}
+
+
+void PackedMask::bitwiseAnd(const PackedMask& other) {
+	CV_Assert(other.width == this->width && other.height == this->height);
+	for (size_t i = 0; i < this->words.size(); i++) {
+		this->words[i] &= other.words[i];
+	}
+}
+
+
+void PackedMask::bitwiseOr(const PackedMask& other) {
+	CV_Assert(other.width == this->width && other.height == this->height);
+	for (size_t i = 0; i < this->words.size(); i++) {
+		this->words[i] |= other.words[i];
+	}
+}
+
+
+uint64_t PackedMask::countNonZero() const {
+	uint64_t count = 0;
+	for (const uint64_t word : this->words) {
+		count += countBits(word);
+	}
+	return count;
+}
+
+
+cv::Rect PackedMask::getBoundingRect() const {
+	int left = this->width;
+	int right = -1;
+	int top = -1;
+	int bottom = -1;
+	for (int y = 0; y < this->height; y++) {
+		const uint64_t* bits = this->row(y);
+		size_t first = 0;
+		while (first < this->rowWords && bits[first] == 0) {
+			first++;
+		}
+		if (first == this->rowWords) {
+			continue;
+		}
+		size_t last = this->rowWords - 1;
+		while (bits[last] == 0) {
+			last--;
+		}
+		left = std::min(left, static_cast<int>(first * 64) + countTrailingZeros(bits[first]));
+		right = std::max(right, static_cast<int>(last * 64) + 63 - countLeadingZeros(bits[last]));
+		if (top < 0) {
+			top = y;
+		}
+		bottom = y;
+	}
+	if (top < 0) {
+		return cv::Rect();
+	}
+	return cv::Rect(left, top, right - left + 1, bottom - top + 1);
+}
+
+
+bool PackedMask::empty() const {
+	return this->words.empty();
+}
+
+
+int PackedMask::getWidth() const {
+	return this->width;
+}
+
+
+int PackedMask::getHeight() const {
+	return this->height;
+}
+
+
+size_t PackedMask::getRowWords() const {
+	return this->rowWords;
+}
+
+
+size_t PackedMask::getNumBytes() const {
+	return this->words.size() * sizeof(uint64_t);
+}
+
+
+const uint64_t* PackedMask::row(int y) const {
+	return this->words.data() + y * this->rowWords;
+}
+
+
+uint64_t* PackedMask::row(int y) {
+	return this->words.data() + y * this->rowWords;
+}
+
+
+void RleMask::encode(const PackedMask& mask) {
+	this->width = mask.getWidth();
+	this->height = mask.getHeight();
+	this->rowOffsets.resize(static_cast<size_t>(this->height) + 1);
+	this->runs.clear();
+	const size_t rowWords = mask.getRowWords();
+	for (int y = 0; y < this->height; y++) {
+		this->rowOffsets[y] = static_cast<uint32_t>(this->runs.size() / 2);
+		const uint64_t* bits = mask.row(y);
+		bool isInRun = false;
+		for (size_t w = 0; w < rowWords; w++) {
+			const uint32_t base = static_cast<uint32_t>(w * 64);
+			int bit = 0;
+			while (bit < 64) {
+				const uint64_t pending = (isInRun ? ~bits[w] : bits[w]) & (~uint64_t(0) << bit);
+				if (pending == 0) {
+					break;
+				}
+				bit = countTrailingZeros(pending);
+				this->runs.push_back(base + bit);
+				isInRun = !isInRun;
+			}
+		}
+		if (isInRun) {
+			this->runs.push_back(static_cast<uint32_t>(this->width));
+		}
+	}
+	this->rowOffsets[this->height] = static_cast<uint32_t>(this->runs.size() / 2);
+}
+
+
+void RleMask::decode(PackedMask& mask) const {
+	mask.create(this->width, this->height);
+	for (int y = 0; y < this->height; y++) {
+		uint64_t* bits = mask.row(y);
+		for (uint32_t i = this->rowOffsets[y]; i < this->rowOffsets[y + 1]; i++) {
+			setBitRange(bits, this->runs[2 * i], this->runs[2 * i + 1]);
+		}
+	}
+}
+
+
+uint64_t RleMask::countNonZero() const {
+	uint64_t count = 0;
+	for (size_t i = 0; i + 1 < this->runs.size(); i += 2) {
+		count += this->runs[i + 1] - this->runs[i];
+	}
+	return count;
+}
+
+
+cv::Rect RleMask::getBoundingRect() const {
+	int left = this->width;
+	int right = 0;
+	int top = -1;
+	int bottom = -1;
+	for (int y = 0; y < this->height; y++) {
+		const uint32_t first = this->rowOffsets[y];
+		const uint32_t last = this->rowOffsets[y + 1];
+		if (first == last) {
+			continue;
+		}
+		left = std::min(left, static_cast<int>(this->runs[2 * first]));
+		right = std::max(right, static_cast<int>(this->runs[2 * last - 1]));
+		if (top < 0) {
+			top = y;
+		}
+		bottom = y;
+	}
+	if (top < 0) {
+		return cv::Rect();
+	}
+	return cv::Rect(left, top, right - left, bottom - top + 1);
+}
+
+
+int RleMask::getWidth() const {
+	return this->width;
+}
+
+
+int RleMask::getHeight() const {
+	return this->height;
+}
+
+
+size_t RleMask::getNumRuns() const {
+	return this->runs.size() / 2;
+}
+
+
+size_t RleMask::getNumBytes() const {
+	return (this->rowOffsets.size() + this->runs.size()) * sizeof(uint32_t);
+}
+
+
+bool RleMask::write(std::ostream& stream) const {
+	const uint32_t header[4] = {
+		rleMagic,
+		static_cast<uint32_t>(this->width),
+		static_cast<uint32_t>(this->height),
+		static_cast<uint32_t>(this->runs.size() / 2),
+	};
+	stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+	stream.write(
+		reinterpret_cast<const char*>(this->rowOffsets.data()),
+		this->rowOffsets.size() * sizeof(uint32_t)
+	);
+	stream.write(
+		reinterpret_cast<const char*>(this->runs.data()),
+		this->runs.size() * sizeof(uint32_t)
+	);
+	return stream.good();
+}
+
+
+bool RleMask::read(std::istream& stream) {
+	uint32_t header[4] = {};
+	if (!stream.read(reinterpret_cast<char*>(header), sizeof(header))) {
+		return false;
+	}
+	if (header[0] != rleMagic || header[1] > INT32_MAX || header[2] > INT32_MAX) {
+		return false;
+	}
+	this->width = static_cast<int>(header[1]);
+	this->height = static_cast<int>(header[2]);
+	this->rowOffsets.resize(static_cast<size_t>(this->height) + 1);
+	this->runs.resize(static_cast<size_t>(header[3]) * 2);
+	stream.read(
+		reinterpret_cast<char*>(this->rowOffsets.data()),
+		this->rowOffsets.size() * sizeof(uint32_t)
+	);
+	stream.read(
+		reinterpret_cast<char*>(this->runs.data()),
+		this->runs.size() * sizeof(uint32_t)
+	);
+	bool isValid = (
+		stream.good() && this->rowOffsets.front() == 0 &&
+		this->rowOffsets.back() == header[3] &&
+		std::is_sorted(this->rowOffsets.begin(), this->rowOffsets.end())
+	);
+	for (size_t i = 0; isValid && i < this->runs.size(); i += 2) {
+		isValid = (
+			this->runs[i] < this->runs[i + 1] && this->runs[i + 1] <= header[1]
+		);
+	}
+	if (!isValid) {
+		this->width = NULL;
+		this->height = NULL;
+		this->rowOffsets.clear();
+		this->runs.clear();
+	}
+	return isValid;
+}
\ No newline at end of file
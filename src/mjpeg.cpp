@@ -0,0 +1,387 @@
+#include "mjpeg.h"
+#include <turbojpeg.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+
+using namespace kop;
+
+
+namespace {
+
+	const unsigned char START_OF_IMAGE[2] = { 0xFF, 0xD8 };
+	const unsigned char END_OF_IMAGE[2] = { 0xFF, 0xD9 };
+
+
+	bool hasExtension(const std::string& path, const char* extension) {
+		const std::string ext(extension);
+		if (path.size() < ext.size()) {
+			return false;
+		}
+		return std::equal(
+			ext.rbegin(), ext.rend(), path.rbegin(),
+			[](char a, char b) { return a == std::tolower(b); }
+		);
+	}
+
+}
+
+
+MjpegReader::~MjpegReader() {
+	this->release();
+}
+
+
+bool MjpegReader::openCamera(unsigned int cameraId, int width, int height) {
+	this->release();
+	this->capture.open(cameraId);
+	if (!this->capture.isOpened()) {
+		this->capture.release();
+		return false;
+	}
+	this->capture.set(
+		cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M', 'J', 'P', 'G')
+	);
+	this->capture.set(cv::CAP_PROP_CONVERT_RGB, 0);
+	this->capture.set(cv::CAP_PROP_FRAME_WIDTH, width);
+	this->capture.set(cv::CAP_PROP_FRAME_HEIGHT, height);
+	this->width = static_cast<int>(
+		this->capture.get(cv::CAP_PROP_FRAME_WIDTH)
+		);
+	this->height = static_cast<int>(
+		this->capture.get(cv::CAP_PROP_FRAME_HEIGHT)
+		);
+	this->isCamera = true;
+	this->startTime = std::chrono::steady_clock::now();
+	return true;
+}
+
+
+bool MjpegReader::openFile(const std::string& path, double fps) {
+	this->release();
+	std::vector<unsigned char> packet;
+	if (hasExtension(path, ".mjpeg") || hasExtension(path, ".mjpg")) {
+		this->stream.open(path, std::ios::binary);
+		if (!this->stream.is_open() || !this->readStreamPacket(packet)) {
+			this->release();
+			return false;
+		}
+		this->stream.clear();
+		this->stream.seekg(0);
+		this->streamBuffer.clear();
+		this->streamOffset = 0;
+		this->frameInterval = 1.0e6 / std::max(fps, 1.0);
+	}
+	else {
+		this->capture.open(path, cv::CAP_FFMPEG);
+		if (!this->capture.isOpened()) {
+			this->release();
+			return false;
+		}
+		this->capture.set(cv::CAP_PROP_FORMAT, -1);
+		if (!this->capture.read(this->rawPacket) || this->rawPacket.empty()) {
+			this->release();
+			return false;
+		}
+		packet.assign(
+			this->rawPacket.data,
+			this->rawPacket.data + this->rawPacket.total() * this->rawPacket.elemSize()
+		);
+		this->capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+	}
+	if (!this->probeSize(packet)) {
+		this->release();
+		return false;
+	}
+	this->numPackets = 0;
+	this->isCamera = false;
+	return true;
+}
+
+
+bool MjpegReader::isOpened() const {
+	return this->capture.isOpened() || this->stream.is_open();
+}
+
+
+void MjpegReader::release() {
+	this->capture.release();
+	if (this->stream.is_open()) {
+		this->stream.close();
+	}
+	this->streamBuffer.clear();
+	this->streamOffset = 0;
+	this->numPackets = 0;
+}
+
+
+bool MjpegReader::read(
+	std::vector<unsigned char>& packet, int64_t& timestamp
+) {
+	if (this->stream.is_open()) {
+		if (!this->readStreamPacket(packet)) {
+			return false;
+		}
+		timestamp = static_cast<int64_t>(this->numPackets * this->frameInterval);
+		this->numPackets += 1;
+		return true;
+	}
+	if (!this->capture.read(this->rawPacket) || this->rawPacket.empty()) {
+		return false;
+	}
+	packet.assign(
+		this->rawPacket.data,
+		this->rawPacket.data + this->rawPacket.total() * this->rawPacket.elemSize()
+	);
+	if (this->isCamera) {
+		timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - this->startTime
+		).count();
+	}
+	else {
+		timestamp = static_cast<int64_t>(
+			1000.0 * this->capture.get(cv::CAP_PROP_POS_MSEC)
+		);
+	}
+	this->numPackets += 1;
+	return true;
+}
+
+
+int MjpegReader::getWidth() const {
+	return this->width;
+}
+
+
+int MjpegReader::getHeight() const {
+	return this->height;
+}
+
+
+bool MjpegReader::readStreamPacket(std::vector<unsigned char>& packet) {
+	size_t start = SIZE_MAX;
+	size_t searchFrom = this->streamOffset;
+	while (true) {
+		const auto begin = this->streamBuffer.begin();
+		const auto end = this->streamBuffer.end();
+		if (start == SIZE_MAX) {
+			const auto marker = std::search(
+				begin + searchFrom, end, START_OF_IMAGE, START_OF_IMAGE + 2
+			);
+			if (marker != end) {
+				start = static_cast<size_t>(marker - begin);
+				searchFrom = start + 2;
+			}
+		}
+		if (start != SIZE_MAX) {
+			const auto marker = std::search(
+				begin + searchFrom, end, END_OF_IMAGE, END_OF_IMAGE + 2
+			);
+			if (marker != end) {
+				packet.assign(begin + start, marker + 2);
+				this->streamOffset = static_cast<size_t>(marker - begin) + 2;
+				return true;
+			}
+		}
+		if (!this->streamBuffer.empty()) {
+			searchFrom = std::max(searchFrom, this->streamBuffer.size() - 1);
+		}
+		const size_t consumed = std::min(start, searchFrom);
+		this->streamBuffer.erase(begin, begin + consumed);
+		this->streamOffset = 0;
+		searchFrom -= consumed;
+		if (start != SIZE_MAX) {
+			start -= consumed;
+		}
+		const size_t oldSize = this->streamBuffer.size();
+		this->streamBuffer.resize(oldSize + MjpegReader::streamChunkSize);
+		this->stream.read(
+			reinterpret_cast<char*>(this->streamBuffer.data() + oldSize),
+			MjpegReader::streamChunkSize
+		);
+		const size_t numRead = static_cast<size_t>(this->stream.gcount());
+		this->streamBuffer.resize(oldSize + numRead);
+		if (numRead == 0) {
+			return false;
+		}
+	}
+}
+
+
+bool MjpegReader::probeSize(const std::vector<unsigned char>& packet) {
+	tjhandle handle = tjInitDecompress();
+	if (!handle) {
+		return false;
+	}
+	int subsampling = 0;
+	int colorspace = 0;
+	const int status = tjDecompressHeader3(
+		handle, packet.data(), static_cast<unsigned long>(packet.size()),
+		&this->width, &this->height, &subsampling, &colorspace
+	);
+	tjDestroy(handle);
+	return status == 0;
+}
+
+
+MjpegDecoder::MjpegDecoder(
+	int width,
+	int height,
+	size_t numWorkers,
+	size_t numBuffers
+)
+	: width(width),
+	  height(height),
+	  slots(std::max(numBuffers, size_t(1)))
+{
+	for (Slot& slot : this->slots) {
+		slot.image = cv::Mat(height, width, CV_8UC3);
+	}
+	for (size_t i = 0; i < std::max(numWorkers, size_t(1)); i++) {
+		this->workers.emplace_back(&MjpegDecoder::workerThread, this);
+	}
+}
+
+
+MjpegDecoder::~MjpegDecoder() {
+	{
+		std::lock_guard<std::mutex> lock(this->locker);
+		this->stopping = true;
+	}
+	this->jobSignal.notify_all();
+	this->slotSignal.notify_all();
+	for (std::thread& worker : this->workers) {
+		worker.join();
+	}
+}
+
+
+bool MjpegDecoder::submit(
+	const unsigned char* data, size_t size,
+	int64_t timestamp, bool wait
+) {
+	std::unique_lock<std::mutex> lock(this->locker);
+	const size_t index = this->submitSequence % this->slots.size();
+	Slot& slot = this->slots[index];
+	if (slot.state != SlotState::Free) {
+		if (!wait) {
+			return false;
+		}
+		this->slotSignal.wait(lock, [&]() {
+			return this->stopping || slot.state == SlotState::Free;
+		});
+		if (this->stopping) {
+			return false;
+		}
+	}
+	slot.packet.assign(data, data + size);
+	slot.timestamp = timestamp;
+	slot.state = SlotState::Queued;
+	this->jobs.push_back(index);
+	this->submitSequence += 1;
+	lock.unlock();
+	this->jobSignal.notify_one();
+	return true;
+}
+
+
+bool MjpegDecoder::acquire(cv::Mat& image, int64_t& timestamp, bool wait) {
+	std::unique_lock<std::mutex> lock(this->locker);
+	while (this->acquireSequence < this->submitSequence) {
+		Slot& slot = this->slots[this->acquireSequence % this->slots.size()];
+		if (slot.state == SlotState::Queued) {
+			if (!wait) {
+				return false;
+			}
+			this->slotSignal.wait(lock, [&]() {
+				return this->stopping || slot.state != SlotState::Queued;
+			});
+			if (this->stopping) {
+				return false;
+			}
+		}
+		if (slot.state == SlotState::Acquired) {
+			return false;
+		}
+		this->acquireSequence += 1;
+		if (slot.state == SlotState::Failed) {
+			slot.state = SlotState::Free;
+			this->slotSignal.notify_all();
+			continue;
+		}
+		slot.state = SlotState::Acquired;
+		image = slot.image;
+		timestamp = slot.timestamp;
+		return true;
+	}
+	return false;
+}
+
+
+void MjpegDecoder::release() {
+	{
+		std::lock_guard<std::mutex> lock(this->locker);
+		if (this->acquireSequence == 0) {
+			return;
+		}
+		Slot& slot = this->slots[
+			(this->acquireSequence - 1) % this->slots.size()
+		];
+		if (slot.state != SlotState::Acquired) {
+			return;
+		}
+		slot.state = SlotState::Free;
+	}
+	this->slotSignal.notify_all();
+}
+
+
+size_t MjpegDecoder::getNumWorkers() const {
+	return this->workers.size();
+}
+
+
+void MjpegDecoder::workerThread() {
+	tjhandle handle = tjInitDecompress();
+	while (true) {
+		size_t index = 0;
+		{
+			std::unique_lock<std::mutex> lock(this->locker);
+			this->jobSignal.wait(lock, [&]() {
+				return this->stopping || !this->jobs.empty();
+			});
+			if (this->stopping) {
+				break;
+			}
+			index = this->jobs.front();
+			this->jobs.pop_front();
+		}
+		Slot& slot = this->slots[index];
+		int packetWidth = 0;
+		int packetHeight = 0;
+		int subsampling = 0;
+		int colorspace = 0;
+		const unsigned long packetSize = static_cast<unsigned long>(
+			slot.packet.size()
+		);
+		bool isDecoded = handle && tjDecompressHeader3(
+			handle, slot.packet.data(), packetSize,
+			&packetWidth, &packetHeight, &subsampling, &colorspace
+		) == 0;
+		isDecoded = isDecoded &&
+			packetWidth == this->width && packetHeight == this->height;
+		isDecoded = isDecoded && tjDecompress2(
+			handle, slot.packet.data(), packetSize, slot.image.data,
+			this->width, static_cast<int>(slot.image.step),
+			this->height, TJPF_BGR, TJFLAG_FASTDCT
+		) == 0;
+		{
+			std::lock_guard<std::mutex> lock(this->locker);
+			slot.state = isDecoded ? SlotState::Decoded : SlotState::Failed;
+		}
+		this->slotSignal.notify_all();
+	}
+	if (handle) {
+		tjDestroy(handle);
+	}
+}
\ No newline at end of file
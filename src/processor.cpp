@@ -0,0 +1,471 @@
+#include "processor.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+
+using namespace kop;
+
+
+namespace {
+
+	double getElapsedMillis(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start
+		).count();
+	}
+
+}
+
+
+double PyramidStats::getSpeedup() const {
+	if (this->pyramidMillis <= 0.0) {
+		return 1.0;
+	}
+	return this->referenceMillis / this->pyramidMillis;
+}
+
+
+Processor::Processor() {
+	for (cv::Mat* image : this->getFrameImages()) {
+		image->allocator = &this->arena;
+	}
+}
+
+
+void Processor::setRange(
+	const std::array<float, 3>& lowerHSV,
+	const std::array<float, 3>& upperHSV
+) {
+	this->lowerBound = cv::Scalar(
+		180.0f * lowerHSV[0], 255.0f * lowerHSV[1], 255.0f * lowerHSV[2]
+	);
+	this->upperBound = cv::Scalar(
+		180.0f * upperHSV[0], 255.0f * upperHSV[1], 255.0f * upperHSV[2]
+	);
+}
+
+
+void Processor::setBlobOptions(bool enabled, uint64_t minArea) {
+	this->blobsEnabled = enabled;
+	this->blobExtractor.setMinArea(minArea);
+}
+
+
+void Processor::setTileTracking(bool enabled) {
+	if (enabled && !this->tilesEnabled) {
+		this->originalTiles.reset();
+		this->filteredTiles.reset();
+	}
+	this->tilesEnabled = enabled;
+}
+
+
+void Processor::setRoiTracking(bool enabled, int refreshInterval) {
+	this->roiTracker.setEnabled(enabled);
+	this->roiTracker.setRefreshInterval(refreshInterval);
+}
+
+
+void Processor::setPyramidLevel(int level) {
+	level = std::clamp(level, 0, Processor::maxPyramidLevel);
+	if (level != this->pyramidLevel) {
+		this->pyramidStats = PyramidStats();
+	}
+	this->pyramidLevel = level;
+}
+
+
+void Processor::setBlurSize(int size) {
+	this->blurSize = std::clamp(size | 1, 1, Processor::maxBlurSize);
+}
+
+
+void Processor::setBlurType(BlurType type) {
+	this->blurType = type;
+}
+
+
+void Processor::setStatistics(bool enabled, const cv::Rect& region, float decay) {
+	this->statistics.setEnabled(enabled);
+	this->statistics.setRegion(region);
+	this->statistics.setDecay(decay);
+}
+
+
+bool Processor::setGraph(ProcessingGraph* graph) {
+	if (
+		graph &&
+		(!graph->requireOutput("original", CV_8UC4) || !graph->requireOutput("mask", CV_8UC1))
+	) {
+		return false;
+	}
+	this->graph = graph;
+	return true;
+}
+
+
+bool Processor::reserveArena(size_t frameBytes, bool hugePages, int numaNode) {
+	for (cv::Mat* image : this->getFrameImages()) {
+		image->release();
+	}
+	return this->arena.reserve(
+		frameBytes * Processor::arenaFramesPerCapacity, hugePages, numaNode
+	);
+}
+
+
+bool Processor::processRgb(const cv::Mat& rgb, bool flip) {
+	this->beginFrame();
+	FrameArena::Scope arenaScope(this->arena);
+	if (rgb.empty()) {
+		return false;
+	}
+	if (flip) {
+		cv::flip(rgb, this->rgbFrame, -1);
+		this->processColorFrame(
+			this->rgbFrame, cv::COLOR_RGB2RGBA, cv::COLOR_RGB2HSV
+		);
+	}
+	else {
+		this->processColorFrame(rgb, cv::COLOR_RGB2RGBA, cv::COLOR_RGB2HSV);
+	}
+	return true;
+}
+
+
+bool Processor::processBgr(const cv::Mat& bgr) {
+	this->beginFrame();
+	FrameArena::Scope arenaScope(this->arena);
+	if (bgr.empty()) {
+		return false;
+	}
+	this->processColorFrame(bgr, cv::COLOR_BGR2RGBA, cv::COLOR_BGR2HSV);
+	return true;
+}
+
+
+bool Processor::processNative(
+	const cv::Mat& yuv, PixelFormat format, bool flip
+) {
+	this->beginFrame();
+	FrameArena::Scope arenaScope(this->arena);
+	if (yuv.empty()) {
+		return false;
+	}
+	blurNativeFrame(
+		yuv, format, this->blurType, this->blurSize / 2, this->blurredFrame
+	);
+	HsvStatistics* statistics = this->statistics.isEnabled()
+		? &this->statistics
+		: nullptr;
+	if (statistics) {
+		statistics->beginFrame(cv::Point(), 1);
+	}
+	convertYuvToRgbaHsv(
+		this->blurredFrame, format, flip, flip,
+		this->originalFrame, this->hsvImage, statistics
+	);
+	if (statistics) {
+		statistics->endFrame();
+	}
+	this->roiTracker.predict(this->originalFrame.size());
+	this->processedRoi = cv::Rect(cv::Point(), this->originalFrame.size());
+	this->threshold();
+	this->composite();
+	return true;
+}
+
+
+const cv::Mat& Processor::getOriginalFrame() const {
+	return this->originalFrame;
+}
+
+
+const cv::Mat& Processor::getFilteredFrame() const {
+	return this->filteredFrame;
+}
+
+
+const cv::Mat& Processor::getHsvImage() const {
+	return this->hsvImage;
+}
+
+
+const cv::Mat& Processor::getMask() const {
+	return this->hsvMask;
+}
+
+
+const std::vector<Blob>& Processor::getBlobs() const {
+	return this->blobExtractor.getBlobs();
+}
+
+
+const cv::Rect& Processor::getProcessedRoi() const {
+	return this->processedRoi;
+}
+
+
+const RoiTracker& Processor::getRoiTracker() const {
+	return this->roiTracker;
+}
+
+
+int Processor::getPyramidLevel() const {
+	return this->pyramidLevel;
+}
+
+
+int Processor::getBlurSize() const {
+	return this->blurSize;
+}
+
+
+BlurType Processor::getBlurType() const {
+	return this->blurType;
+}
+
+
+const PyramidStats& Processor::getPyramidStats() const {
+	return this->pyramidStats;
+}
+
+
+const HsvStatistics& Processor::getStatistics() const {
+	return this->statistics;
+}
+
+
+const DirtyTiles& Processor::getOriginalTiles() const {
+	return this->originalTiles;
+}
+
+
+const DirtyTiles& Processor::getFilteredTiles() const {
+	return this->filteredTiles;
+}
+
+
+const FrameArena& Processor::getArena() const {
+	return this->arena;
+}
+
+
+const cv::Scalar Processor::nullColor = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+
+std::array<cv::Mat*, 10> Processor::getFrameImages() {
+	return {
+		&this->rgbFrame, &this->blurredFrame, &this->hsvImage,
+		&this->hsvMask, &this->originalFrame, &this->filteredFrame,
+		&this->levelFrame, &this->levelMask, &this->levelBoundary,
+		&this->boundaryMask,
+	};
+}
+
+
+void Processor::beginFrame() {
+	for (cv::Mat* image : this->getFrameImages()) {
+		image->release();
+		image->allocator = &this->arena;
+	}
+	this->arena.reset();
+}
+
+
+cv::Mat Processor::blurFrame(
+	const cv::Mat& image, cv::Mat& blurred, int size
+) const {
+	if (size <= 1) {
+		return image;
+	}
+	blurImage(image, blurred, this->blurType, size / 2);
+	return blurred;
+}
+
+
+cv::Mat Processor::blurWindow(const cv::Mat& image, const cv::Rect& roi) {
+	if (this->blurSize <= 1) {
+		return image(roi);
+	}
+	const int border = boxBlurPasses * (this->blurSize / 2 + 1);
+	const cv::Rect padded = cv::Rect(
+		roi.x - border, roi.y - border,
+		roi.width + 2 * border, roi.height + 2 * border
+	) & cv::Rect(cv::Point(), image.size());
+	this->blurredFrame.create(image.size(), image.type());
+	cv::Mat window = this->blurredFrame(padded);
+	blurImage(image(padded), window, this->blurType, this->blurSize / 2);
+	return this->blurredFrame(roi);
+}
+
+
+void Processor::processColorFrame(
+	const cv::Mat& image, int rgbaCode, int hsvCode
+) {
+	if (this->graph) {
+		this->processGraph(image, rgbaCode == cv::COLOR_BGR2RGBA);
+	}
+	else if (this->pyramidLevel > 0) {
+		this->thresholdPyramid(image, rgbaCode, hsvCode);
+	}
+	else {
+		this->convertColorFrame(image, rgbaCode, hsvCode);
+		this->threshold();
+	}
+	this->composite();
+}
+
+
+void Processor::convertColorFrame(
+	const cv::Mat& image, int rgbaCode, int hsvCode
+) {
+	this->processedRoi = this->roiTracker.predict(image.size());
+	const cv::Rect& roi = this->processedRoi;
+	if (roi.size() == image.size()) {
+		const cv::Mat blurred = this->blurFrame(
+			image, this->blurredFrame, this->blurSize
+		);
+		cv::cvtColor(blurred, this->originalFrame, rgbaCode);
+		this->convertHsv(blurred, hsvCode, cv::Point(), 1);
+		return;
+	}
+	const cv::Mat blurred = this->blurWindow(image, roi);
+	cv::cvtColor(image, this->originalFrame, rgbaCode);
+	cv::Mat originalRoi = this->originalFrame(roi);
+	cv::cvtColor(blurred, originalRoi, rgbaCode);
+	this->convertHsv(blurred, hsvCode, roi.tl(), 1);
+}
+
+
+void Processor::processGraph(const cv::Mat& image, bool isBgr) {
+	this->roiTracker.predict(image.size());
+	this->processedRoi = cv::Rect(cv::Point(), image.size());
+	this->graph->setRange(this->lowerBound, this->upperBound);
+	this->graph->run(image, isBgr);
+	this->originalFrame = this->graph->getOutput("original");
+	this->hsvMask = this->graph->getOutput("mask");
+	if (this->graph->hasOutput("filtered", CV_8UC4)) {
+		this->filteredFrame = this->graph->getOutput("filtered");
+	}
+}
+
+
+void Processor::convertHsv(
+	const cv::Mat& image, int hsvCode, const cv::Point& origin, int scale
+) {
+	if (!this->statistics.isEnabled()) {
+		cv::cvtColor(image, this->hsvImage, hsvCode);
+		return;
+	}
+	this->statistics.beginFrame(origin, scale);
+	convertRgbToHsv(
+		image, hsvCode == cv::COLOR_BGR2HSV, this->hsvImage, &this->statistics
+	);
+	this->statistics.endFrame();
+}
+
+
+void Processor::threshold() {
+	const cv::Rect& roi = this->processedRoi;
+	this->hsvMask.create(this->originalFrame.size(), CV_8UC1);
+	if (roi.size() != this->originalFrame.size()) {
+		this->hsvMask.setTo(0);
+	}
+	cv::Mat roiMask = this->hsvMask(roi);
+	cv::inRange(this->hsvImage, this->lowerBound, this->upperBound, roiMask);
+}
+
+
+void Processor::thresholdPyramid(
+	const cv::Mat& image, int rgbaCode, int hsvCode
+) {
+	this->roiTracker.predict(image.size());
+	this->processedRoi = cv::Rect(cv::Point(), image.size());
+	const auto startTime = std::chrono::steady_clock::now();
+	const cv::Mat blurred = this->blurFrame(
+		image, this->blurredFrame, this->blurSize
+	);
+	const double blurMillis = getElapsedMillis(startTime);
+	const int scale = 1 << this->pyramidLevel;
+	const cv::Size levelSize(
+		(image.cols + scale - 1) / scale, (image.rows + scale - 1) / scale
+	);
+	cv::resize(blurred, this->levelFrame, levelSize, 0.0, 0.0, cv::INTER_AREA);
+	this->convertHsv(this->levelFrame, hsvCode, cv::Point(), scale);
+	cv::inRange(this->hsvImage, this->lowerBound, this->upperBound, this->levelMask);
+	cv::morphologyEx(
+		this->levelMask, this->levelBoundary, cv::MORPH_GRADIENT, cv::Mat()
+	);
+	cv::resize(
+		this->levelMask, this->hsvMask, image.size(), 0.0, 0.0, cv::INTER_NEAREST
+	);
+	cv::resize(
+		this->levelBoundary, this->boundaryMask, image.size(),
+		0.0, 0.0, cv::INTER_NEAREST
+	);
+	this->pyramidStats.refinedPixels = refineMaskBoundary(
+		blurred, rgbaCode == cv::COLOR_BGR2RGBA, this->boundaryMask,
+		this->lowerBound, this->upperBound, this->hsvMask
+	);
+	this->pyramidStats.frames += 1;
+	if ((this->pyramidStats.frames - 1) % Processor::pyramidReferenceInterval == 0) {
+		this->pyramidStats.pyramidMillis = getElapsedMillis(startTime);
+		this->measurePyramidAccuracy(blurred, hsvCode, blurMillis);
+	}
+	cv::cvtColor(blurred, this->originalFrame, rgbaCode);
+}
+
+
+void Processor::measurePyramidAccuracy(
+	const cv::Mat& blurred, int hsvCode, double blurMillis
+) {
+	cv::Mat hsv;
+	cv::Mat reference;
+	cv::Mat overlap;
+	for (cv::Mat* referenceImage : { &hsv, &reference, &overlap }) {
+		referenceImage->allocator = &this->arena;
+	}
+	const auto startTime = std::chrono::steady_clock::now();
+	cv::cvtColor(blurred, hsv, hsvCode);
+	cv::inRange(hsv, this->lowerBound, this->upperBound, reference);
+	this->pyramidStats.referenceMillis = blurMillis + getElapsedMillis(startTime);
+	cv::bitwise_and(reference, this->hsvMask, overlap);
+	const int intersection = cv::countNonZero(overlap);
+	cv::bitwise_or(reference, this->hsvMask, overlap);
+	const int coverage = cv::countNonZero(overlap);
+	this->pyramidStats.accuracy = (coverage == 0)
+		? 1.0
+		: static_cast<double>(intersection) / coverage;
+}
+
+
+void Processor::composite() {
+	const cv::Rect& roi = this->processedRoi;
+	cv::Mat roiMask = this->hsvMask(roi);
+	if (this->filteredFrame.empty()) {
+		this->filteredFrame.create(this->originalFrame.size(), this->originalFrame.type());
+		if (roi.size() != this->originalFrame.size()) {
+			this->filteredFrame.setTo(Processor::nullColor);
+		}
+		cv::Mat roiFiltered = this->filteredFrame(roi);
+		roiFiltered.setTo(Processor::nullColor);
+		this->originalFrame(roi).copyTo(roiFiltered, roiMask);
+	}
+	this->blobExtractor.extract(this->blobsEnabled ? this->hsvMask : cv::Mat());
+	if (this->roiTracker.isEnabled()) {
+		const std::vector<Blob>& blobs = this->blobExtractor.getBlobs();
+		cv::Rect detection = cv::Rect();
+		if (!this->blobsEnabled) {
+			detection = cv::boundingRect(roiMask) + roi.tl();
+		}
+		else if (!blobs.empty()) {
+			detection = blobs.front().boundingBox;
+		}
+		this->roiTracker.update(roi, detection);
+	}
+	if (this->tilesEnabled) {
+		this->originalTiles.update(this->originalFrame);
+		this->filteredTiles.update(this->filteredFrame);
+	}
+}
\ No newline at end of file
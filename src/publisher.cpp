@@ -0,0 +1,240 @@
+#if defined(_WIN32)
+#define NOMINMAX
+#endif
+#include "publisher.h"
+#include "kcf_shm.h"
+#include <algorithm>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <signal.h>
+#endif
+
+using namespace kop;
+
+static_assert(sizeof(kcf_shm_slot) == 64, "Publisher: Slot must be 64 bytes.");
+static_assert(sizeof(kcf_shm_header) % KCF_SHM_ALIGNMENT == 0, "Publisher: Header must be aligned.");
+
+
+namespace {
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+#if !defined(_WIN32)
+
+	bool isStaleSegment(const char* name) {
+		const int file = shm_open(name, O_RDONLY, 0);
+		if (file < 0) {
+			return errno == ENOENT;
+		}
+		bool isStale = true;
+		struct stat status;
+		if (
+			fstat(file, &status) == 0 &&
+			static_cast<size_t>(status.st_size) >= sizeof(kcf_shm_header)
+		) {
+			void* mapped = mmap(
+				nullptr, sizeof(kcf_shm_header), PROT_READ, MAP_SHARED, file, 0
+			);
+			if (mapped != MAP_FAILED) {
+				const kcf_shm_header* header = static_cast<const kcf_shm_header*>(
+					mapped
+				);
+				isStale = (
+					header->magic != KCF_SHM_MAGIC || header->producer == 0 ||
+					(kill(static_cast<pid_t>(header->producer), 0) != 0 && errno == ESRCH)
+				);
+				munmap(mapped, sizeof(kcf_shm_header));
+			}
+		}
+		close(file);
+		return isStale;
+	}
+
+
+	int createSegment(const char* name) {
+		int file = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0660);
+		if (file < 0 && errno == EEXIST && isStaleSegment(name)) {
+			shm_unlink(name);
+			file = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0660);
+		}
+		return file;
+	}
+
+#endif
+
+}
+
+
+FramePublisher::~FramePublisher() {
+	this->destroy();
+}
+
+
+bool FramePublisher::create(
+	const std::string& name, int width, int height, bool packedMask,
+	size_t numSlots
+) {
+	this->destroy();
+	if (name.empty() || width <= 0 || height <= 0) {
+		return false;
+	}
+	numSlots = std::clamp(numSlots, size_t(2), size_t(KCF_SHM_MAX_SLOTS));
+	const uint64_t numPixels = static_cast<uint64_t>(width) * height;
+	const uint64_t maskStride = packedMask
+		? (static_cast<uint64_t>(width) + 63) / 64 * 8
+		: static_cast<uint64_t>(width);
+	const uint64_t filteredOffset = alignUp(maskStride * height, KCF_SHM_ALIGNMENT);
+	const uint64_t slotStride = alignUp(filteredOffset + numPixels * 4, 4096);
+	const uint64_t dataOffset = alignUp(sizeof(kcf_shm_header), 4096);
+	const size_t size = static_cast<size_t>(dataOffset + numSlots * slotStride);
+#if defined(_WIN32)
+	this->name = name;
+	HANDLE mapping = CreateFileMappingA(
+		INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+		static_cast<DWORD>(size & 0xFFFFFFFFull), this->name.c_str()
+	);
+	if (!mapping) {
+		return false;
+	}
+	if (GetLastError() == ERROR_ALREADY_EXISTS) {
+		CloseHandle(mapping);
+		return false;
+	}
+	void* mapped = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!mapped) {
+		CloseHandle(mapping);
+		return false;
+	}
+	this->mappingHandle = mapping;
+#else
+	this->name = (name[0] == '/') ? name : "/" + name;
+	const int file = createSegment(this->name.c_str());
+	if (file < 0) {
+		return false;
+	}
+	if (ftruncate(file, static_cast<off_t>(size)) != 0) {
+		close(file);
+		shm_unlink(this->name.c_str());
+		return false;
+	}
+	void* mapped = mmap(
+		nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0
+	);
+	close(file);
+	if (mapped == MAP_FAILED) {
+		shm_unlink(this->name.c_str());
+		return false;
+	}
+#endif
+	this->header = static_cast<kcf_shm_header*>(mapped);
+	this->memorySize = size;
+	std::memset(this->header, 0, sizeof(kcf_shm_header));
+	this->header->version = KCF_SHM_VERSION;
+#if defined(_WIN32)
+	this->header->producer = static_cast<uint32_t>(GetCurrentProcessId());
+#else
+	this->header->producer = static_cast<uint32_t>(getpid());
+#endif
+	this->header->width = width;
+	this->header->height = height;
+	this->header->num_slots = static_cast<uint32_t>(numSlots);
+	this->header->mask_format = packedMask ? KCF_SHM_MASK_BITS : KCF_SHM_MASK_BYTES;
+	this->header->mask_stride = maskStride;
+	this->header->mask_offset = 0;
+	this->header->filtered_offset = filteredOffset;
+	this->header->slot_stride = slotStride;
+	this->header->data_offset = dataOffset;
+	kcf_shm_fence_release();
+	this->header->magic = KCF_SHM_MAGIC;
+	this->numFrames = 0;
+	return true;
+}
+
+
+void FramePublisher::destroy() {
+	if (!this->header) {
+		return;
+	}
+	this->header->magic = 0;
+	kcf_shm_add32(&this->header->superseded, 1);
+	kcf_shm_notify(this->header);
+#if defined(_WIN32)
+	UnmapViewOfFile(this->header);
+	CloseHandle(this->mappingHandle);
+	this->mappingHandle = nullptr;
+#else
+	munmap(this->header, this->memorySize);
+	shm_unlink(this->name.c_str());
+#endif
+	this->header = nullptr;
+	this->memorySize = 0;
+}
+
+
+bool FramePublisher::isCreated() const {
+	return this->header != nullptr;
+}
+
+
+bool FramePublisher::publish(
+	const cv::Mat& mask, const cv::Mat& filtered, int64_t timestamp
+) {
+	if (!this->header) {
+		return false;
+	}
+	const cv::Size size(this->header->width, this->header->height);
+	const bool isMatching = (
+		mask.type() == CV_8UC1 && mask.size() == size && mask.isContinuous() &&
+		filtered.type() == CV_8UC4 && filtered.size() == size &&
+		filtered.isContinuous()
+	);
+	if (!isMatching) {
+		return false;
+	}
+	if (this->header->mask_format == KCF_SHM_MASK_BITS) {
+		this->packedMask.pack(mask);
+	}
+	const uint32_t slotIndex = static_cast<uint32_t>(
+		this->numFrames % this->header->num_slots
+	);
+	kcf_shm_slot& slot = this->header->slots[slotIndex];
+	unsigned char* data = const_cast<unsigned char*>(
+		kcf_shm_slot_data(this->header, slotIndex)
+	);
+	const uint64_t sequence = kcf_shm_load_relaxed(&slot.sequence);
+	kcf_shm_store_relaxed(&slot.sequence, sequence + 1);
+	kcf_shm_fence_release();
+	slot.frame = this->numFrames;
+	slot.timestamp = timestamp;
+	if (this->header->mask_format == KCF_SHM_MASK_BITS) {
+		std::memcpy(
+			data + this->header->mask_offset, this->packedMask.row(0),
+			this->packedMask.getNumBytes()
+		);
+	}
+	else {
+		std::memcpy(data + this->header->mask_offset, mask.data, mask.total());
+	}
+	std::memcpy(
+		data + this->header->filtered_offset, filtered.data, filtered.total() * 4
+	);
+	kcf_shm_store_release(&slot.sequence, sequence + 2);
+	this->numFrames += 1;
+	kcf_shm_store_release(&this->header->latest, this->numFrames);
+	kcf_shm_notify(this->header);
+	return true;
+}
+
+
+uint64_t FramePublisher::getPublishedFrames() const {
+	return this->numFrames;
+}
+
+
+const std::string& FramePublisher::getName() const {
+	return this->name;
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "quality.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+using namespace kop;
+
+
+bool QualitySettings::operator==(const QualitySettings& other) const {
+	return this->mafOrder == other.mafOrder &&
+		this->blurSize == other.blurSize &&
+		this->pyramidLevel == other.pyramidLevel &&
+		this->frameSkip == other.frameSkip;
+}
+
+
+bool QualitySettings::operator!=(const QualitySettings& other) const {
+	return !(*this == other);
+}
+
+
+std::string QualitySettings::toString() const {
+	std::ostringstream stream;
+	stream << "MAF " << this->mafOrder
+		<< ", blur " << this->blurSize
+		<< ", scale 1/" << (1 << this->pyramidLevel)
+		<< ", skip " << this->frameSkip;
+	return stream.str();
+}
+
+
+QualityController::QualityController() {
+	this->rebuildLevels();
+}
+
+
+void QualityController::setEnabled(bool enabled) {
+	if (enabled == this->enabled) {
+		return;
+	}
+	this->enabled = enabled;
+	this->averageMillis = 0.0;
+	this->framesSinceTransition = 0;
+	this->restoreDwell = QualityController::restoreDwellFrames;
+	this->lastWasRestore = false;
+	if (!enabled && this->level != 0) {
+		this->setLevel(0, "Reset");
+	}
+}
+
+
+bool QualityController::isEnabled() const {
+	return this->enabled;
+}
+
+
+void QualityController::setTargetMillis(double millis) {
+	this->targetMillis = std::max(millis, 1.0);
+}
+
+
+double QualityController::getTargetMillis() const {
+	return this->targetMillis;
+}
+
+
+void QualityController::setBaseline(const QualitySettings& settings) {
+	if (settings == this->baseline) {
+		return;
+	}
+	this->baseline = settings;
+	this->rebuildLevels();
+}
+
+
+void QualityController::setPyramidSupported(bool supported) {
+	if (supported == this->pyramidSupported) {
+		return;
+	}
+	this->pyramidSupported = supported;
+	this->rebuildLevels();
+}
+
+
+bool QualityController::update(double frameMillis) {
+	if (!this->enabled) {
+		return false;
+	}
+	this->averageMillis += QualityController::smoothing *
+		(frameMillis - this->averageMillis);
+	this->framesSinceTransition += 1;
+	const bool isOverBudget = (
+		this->averageMillis > QualityController::degradeRatio * this->targetMillis &&
+		this->framesSinceTransition >= QualityController::degradeDwellFrames
+	);
+	if (isOverBudget && this->level + 1 < this->levels.size()) {
+		if (this->lastWasRestore && this->framesSinceTransition < this->restoreDwell) {
+			this->restoreDwell = std::min(
+				2 * this->restoreDwell, QualityController::maxRestoreDwellFrames
+			);
+		}
+		this->lastWasRestore = false;
+		this->setLevel(this->level + 1, "Degraded");
+		return true;
+	}
+	const bool isUnderBudget = (
+		this->averageMillis < QualityController::restoreRatio * this->targetMillis &&
+		this->framesSinceTransition >= this->restoreDwell
+	);
+	if (isUnderBudget && this->level > 0) {
+		this->lastWasRestore = true;
+		this->setLevel(this->level - 1, "Restored");
+		return true;
+	}
+	return false;
+}
+
+
+double QualityController::getAverageMillis() const {
+	return this->averageMillis;
+}
+
+
+size_t QualityController::getLevel() const {
+	return this->level;
+}
+
+
+size_t QualityController::getNumLevels() const {
+	return this->levels.size();
+}
+
+
+uint64_t QualityController::getTransitions() const {
+	return this->transitions;
+}
+
+
+const QualitySettings& QualityController::getSettings() const {
+	return this->levels[this->level];
+}
+
+
+void QualityController::rebuildLevels() {
+	QualitySettings settings = this->baseline;
+	this->levels.assign(1, settings);
+	const auto addLevel = [&]() {
+		if (settings != this->levels.back()) {
+			this->levels.push_back(settings);
+		}
+	};
+	settings.mafOrder = 1;
+	addLevel();
+	settings.blurSize = std::min(settings.blurSize, QualityController::minBlurSize);
+	addLevel();
+	while (
+		this->pyramidSupported &&
+		settings.pyramidLevel < QualityController::maxPyramidLevel
+	) {
+		settings.pyramidLevel += 1;
+		addLevel();
+	}
+	while (settings.frameSkip < QualityController::maxFrameSkip) {
+		settings.frameSkip += 1;
+		addLevel();
+	}
+	this->level = std::min(this->level, this->levels.size() - 1);
+}
+
+
+void QualityController::setLevel(size_t level, const char* transition) {
+	this->level = level;
+	this->framesSinceTransition = 0;
+	this->transitions += 1;
+	std::cout << "Quality: " << transition << " to level " << level
+		<< " (" << this->getSettings().toString() << ") at "
+		<< this->averageMillis << " ms, target "
+		<< this->targetMillis << " ms" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,270 @@
+#include "recording.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace kop;
+
+static_assert(sizeof(RecordingHeader) == 64, "Recording: Header must be 64 bytes.");
+static_assert(
+	sizeof(RecordingIndexEntry) <= recordingFramePrefix,
+	"Recording: Index entry must fit in the frame prefix."
+);
+
+
+namespace {
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+
+	bool isRecordableFormat(int32_t format) {
+		return (
+			format == static_cast<int32_t>(PixelFormat::BGR) ||
+			format == static_cast<int32_t>(PixelFormat::YUYV) ||
+			format == static_cast<int32_t>(PixelFormat::NV12)
+		);
+	}
+
+}
+
+
+FrameRecorder::~FrameRecorder() {
+	this->close();
+}
+
+
+bool FrameRecorder::open(
+	const std::string& path, int width, int height, PixelFormat format
+) {
+	this->close();
+	if (width <= 0 || height <= 0 || !isRecordableFormat(static_cast<int32_t>(format))) {
+		return false;
+	}
+	this->frameBytes = getNativeFrameBytes(format, width, height);
+	this->frameStride = alignUp(
+		recordingFramePrefix + this->frameBytes, recordingAlignment
+	);
+	if (!this->file.create(path, recordingAlignment)) {
+		return false;
+	}
+	if (!this->reserve(FrameRecorder::growFrames)) {
+		this->file.close();
+		return false;
+	}
+	RecordingHeader* header = this->getHeader();
+	*header = RecordingHeader();
+	header->magic = recordingMagic;
+	header->version = recordingVersion;
+	header->width = width;
+	header->height = height;
+	header->format = static_cast<int32_t>(format);
+	header->frameBytes = this->frameBytes;
+	header->frameStride = this->frameStride;
+	return true;
+}
+
+
+bool FrameRecorder::append(const cv::Mat& frame, int64_t timestamp) {
+	if (!this->isOpen() || frame.empty() || !frame.isContinuous()) {
+		return false;
+	}
+	if (frame.total() * frame.elemSize() != this->frameBytes) {
+		return false;
+	}
+	const uint64_t frameIndex = this->index.size();
+	if (frameIndex >= this->capacity) {
+		if (!this->reserve(this->capacity + FrameRecorder::growFrames)) {
+			return false;
+		}
+	}
+	RecordingIndexEntry entry;
+	entry.offset = (
+		recordingAlignment + frameIndex * this->frameStride + recordingFramePrefix
+	);
+	entry.timestamp = timestamp;
+	unsigned char* payload = this->file.getData() + entry.offset;
+	std::memcpy(payload - recordingFramePrefix, &entry, sizeof(entry));
+	std::memcpy(payload, frame.data, this->frameBytes);
+	this->index.push_back(entry);
+	this->getHeader()->numFrames = this->index.size();
+	return true;
+}
+
+
+void FrameRecorder::close() {
+	if (!this->isOpen()) {
+		return;
+	}
+	const uint64_t numFrames = this->index.size();
+	const uint64_t indexOffset = recordingAlignment + numFrames * this->frameStride;
+	const uint64_t indexBytes = numFrames * sizeof(RecordingIndexEntry);
+	if (this->file.resize(static_cast<size_t>(indexOffset + indexBytes))) {
+		if (indexBytes > 0) {
+			std::memcpy(
+				this->file.getData() + indexOffset, this->index.data(), indexBytes
+			);
+		}
+		RecordingHeader* header = this->getHeader();
+		header->numFrames = numFrames;
+		header->indexOffset = indexOffset;
+	}
+	this->file.close();
+	this->index.clear();
+	this->capacity = 0;
+}
+
+
+bool FrameRecorder::isOpen() const {
+	return this->file.isOpen();
+}
+
+
+uint64_t FrameRecorder::getNumFrames() const {
+	return this->index.size();
+}
+
+
+bool FrameRecorder::reserve(uint64_t numFrames) {
+	if (numFrames <= this->capacity) {
+		return true;
+	}
+	const uint64_t size = recordingAlignment + numFrames * this->frameStride;
+	if (!this->file.resize(static_cast<size_t>(size))) {
+		return false;
+	}
+	this->capacity = numFrames;
+	return true;
+}
+
+
+RecordingHeader* FrameRecorder::getHeader() const {
+	return reinterpret_cast<RecordingHeader*>(this->file.getData());
+}
+
+
+bool FrameReplayer::open(const std::string& path) {
+	this->close();
+	if (!this->file.open(path) || this->file.getSize() < recordingAlignment) {
+		this->close();
+		return false;
+	}
+	std::memcpy(&this->header, this->file.getData(), sizeof(this->header));
+	const PixelFormat format = static_cast<PixelFormat>(this->header.format);
+	const bool isValid = (
+		this->header.magic == recordingMagic &&
+		this->header.version == recordingVersion &&
+		this->header.width > 0 && this->header.height > 0 &&
+		isRecordableFormat(this->header.format) &&
+		this->header.frameBytes == getNativeFrameBytes(
+			format, this->header.width, this->header.height
+		) &&
+		this->header.frameStride >= recordingFramePrefix + this->header.frameBytes
+	);
+	if (!isValid) {
+		this->close();
+		return false;
+	}
+	const uint64_t fileSize = this->file.getSize();
+	const unsigned char* data = this->file.getData();
+	const uint64_t indexBytes = this->header.numFrames * sizeof(RecordingIndexEntry);
+	if (this->header.indexOffset != 0 && this->header.indexOffset + indexBytes <= fileSize) {
+		const RecordingIndexEntry* entries = reinterpret_cast<const RecordingIndexEntry*>(
+			data + this->header.indexOffset
+		);
+		this->index.assign(entries, entries + this->header.numFrames);
+	}
+	else {
+		const uint64_t numSlots = (fileSize - recordingAlignment) / this->header.frameStride;
+		const uint64_t numFrames = std::min(this->header.numFrames, numSlots);
+		this->index.resize(numFrames);
+		for (uint64_t i = 0; i < numFrames; i++) {
+			std::memcpy(
+				&this->index[i],
+				data + recordingAlignment + i * this->header.frameStride,
+				sizeof(RecordingIndexEntry)
+			);
+		}
+	}
+	const uint64_t frameBytes = this->header.frameBytes;
+	this->index.erase(
+		std::remove_if(
+			this->index.begin(), this->index.end(),
+			[&](const RecordingIndexEntry& entry) {
+				return entry.offset < recordingAlignment ||
+					entry.offset + frameBytes > fileSize;
+			}
+		),
+		this->index.end()
+	);
+	this->header.numFrames = this->index.size();
+	if (this->index.empty()) {
+		this->close();
+		return false;
+	}
+	this->file.adviseSequential();
+	return true;
+}
+
+
+void FrameReplayer::close() {
+	this->file.close();
+	this->header = RecordingHeader();
+	this->index.clear();
+}
+
+
+bool FrameReplayer::isOpen() const {
+	return this->file.isOpen();
+}
+
+
+int FrameReplayer::getWidth() const {
+	return this->header.width;
+}
+
+
+int FrameReplayer::getHeight() const {
+	return this->header.height;
+}
+
+
+PixelFormat FrameReplayer::getFormat() const {
+	return static_cast<PixelFormat>(this->header.format);
+}
+
+
+uint64_t FrameReplayer::getNumFrames() const {
+	return this->index.size();
+}
+
+
+bool FrameReplayer::readFrame(
+	uint64_t frame, cv::Mat& image, int64_t& timestamp
+) const {
+	if (frame >= this->index.size()) {
+		return false;
+	}
+	const RecordingIndexEntry& entry = this->index[frame];
+	const cv::Mat raw(
+		1, static_cast<int>(this->header.frameBytes), CV_8UC1,
+		this->file.getData() + entry.offset
+	);
+	timestamp = entry.timestamp;
+	if (this->getFormat() == PixelFormat::BGR) {
+		image = raw.reshape(3, this->header.height);
+		return true;
+	}
+	return reshapeNativeFrame(
+		raw, this->getFormat(), this->header.width, this->header.height, image
+	);
+}
+
+
+bool FrameReplayer::isRecording(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	uint32_t magic = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	return file.gcount() == sizeof(magic) && magic == recordingMagic;
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "renderer.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
 #include <stdexcept>
 
 using namespace kop;
@@ -154,4 +155,73 @@ GLFWwindow* Renderer::getWindow() const {
 }
 
 
+bool Renderer::updateTextureRegions(
+	const void* data, size_t index, const std::vector<cv::Rect>&
+) {
+	return this->updateTexture(data, index);
+}
+
+
+bool Renderer::pushHistoryFrame(const void* data) {
+	return this->updateTexture(data, Renderer::historyTarget);
+}
+
+
+bool Renderer::resizeTextures(int width, int height) {
+	return width == this->textureWidth && height == this->textureHeight;
+}
+
+
+bool Renderer::canResizeTextures() const {
+	return false;
+}
+
+
+void Renderer::setTemporalFilter(const TemporalFilter& filter) {
+	this->temporalFilter = filter;
+	this->temporalFilter.depth = std::clamp(
+		filter.depth, 1, static_cast<int>(Renderer::maxHistoryLayers)
+	);
+	this->temporalFilter.decay = std::clamp(filter.decay, 0.0f, 1.0f);
+	if (filter.mode == TemporalMode::Off) {
+		this->historyCount = 0;
+	}
+}
+
+
+const TemporalFilter& Renderer::getTemporalFilter() const {
+	return this->temporalFilter;
+}
+
+
+size_t Renderer::getHistoryCount() const {
+	return this->historyCount;
+}
+
+
+uint64_t Renderer::getUploadedBytes() const {
+	return this->uploadedBytes;
+}
+
+
+bool Renderer::startRecording(const std::string&, double) {
+	return false;
+}
+
+
+void Renderer::stopRecording() {
+
+}
+
+
+bool Renderer::isRecording() const {
+	return false;
+}
+
+
+RecordingStats Renderer::getRecordingStats() const {
+	return RecordingStats();
+}
+
+
 size_t Renderer::numInstances = 0;
@@ -1,5 +1,7 @@
 #include "renderer/opengl.h"
 #include <backends/imgui_impl_opengl3.h>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -42,6 +44,8 @@ OpenGL::OpenGL(
 
 
 OpenGL::~OpenGL() {
+	this->stopRecording();
+	glDeleteTextures(1, &this->retiredTex);
 	glDeleteTextures(1, &this->tex);
 	glDeleteBuffers(1, &this->vbo);
 	glDeleteBuffers(1, &this->ebo);
@@ -71,6 +75,7 @@ void OpenGL::clear() {
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	this->vertexOffset = 0;
 	this->elementOffset = 0;
+	this->uploadedBytes = 0;
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
 }
@@ -104,7 +109,7 @@ bool OpenGL::add(const Object& obj) {
 
 
 bool OpenGL::updateTexture(const void* data, size_t index) {
-	if (!data || index < 0 || index >= Renderer::maxTextures) {
+	if (!data || index >= Renderer::maxTextures) {
 		return false;
 	}
 	glTextureSubImage3D(
@@ -112,11 +117,144 @@ bool OpenGL::updateTexture(const void* data, size_t index) {
 		1, GL_RGBA, GL_UNSIGNED_BYTE, data
 	);
 	glGenerateTextureMipmap(this->tex);
+	this->uploadedBytes += static_cast<uint64_t>(
+		this->textureWidth * this->textureHeight * 4
+	);
+	return true;
+}
+
+
+bool OpenGL::updateTextureRegions(
+	const void* data, size_t index, const std::vector<cv::Rect>& regions
+) {
+	if (!data || index >= Renderer::maxTextures) {
+		return false;
+	}
+	const cv::Rect bounds(0, 0, this->textureWidth, this->textureHeight);
+	const unsigned char* pixels = static_cast<const unsigned char*>(data);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, this->textureWidth);
+	for (const cv::Rect& region : regions) {
+		const cv::Rect rect = region & bounds;
+		if (rect.empty()) {
+			continue;
+		}
+		glTextureSubImage3D(
+			this->tex, 0, rect.x, rect.y, index, rect.width, rect.height,
+			1, GL_RGBA, GL_UNSIGNED_BYTE,
+			pixels + (static_cast<size_t>(rect.y) * this->textureWidth + rect.x) * 4
+		);
+		this->uploadedBytes += static_cast<uint64_t>(rect.area()) * 4;
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	if (!regions.empty()) {
+		glGenerateTextureMipmap(this->tex);
+	}
+	return true;
+}
+
+
+bool OpenGL::pushHistoryFrame(const void* data) {
+	if (!data) {
+		return false;
+	}
+	if (this->temporalFilter.mode == TemporalMode::Off) {
+		return this->updateTexture(data, Renderer::historyTarget);
+	}
+	this->historyHead = (this->historyHead + 1) % Renderer::maxHistoryLayers;
+	this->historyCount = std::min(this->historyCount + 1, Renderer::maxHistoryLayers);
+	glTextureSubImage3D(
+		this->tex, 0, 0, 0, Renderer::maxTextures + this->historyHead,
+		this->textureWidth, this->textureHeight, 1,
+		GL_RGBA, GL_UNSIGNED_BYTE, data
+	);
+	this->uploadedBytes += static_cast<uint64_t>(
+		this->textureWidth * this->textureHeight * 4
+	);
+	return true;
+}
+
+
+bool OpenGL::resizeTextures(int width, int height) {
+	if (width <= 0 || height <= 0) {
+		return false;
+	}
+	if (width == this->textureWidth && height == this->textureHeight) {
+		return true;
+	}
+	if (this->retiredTex) {
+		glDeleteTextures(1, &this->retiredTex);
+	}
+	this->retiredTex = this->tex;
+	this->textureWidth = width;
+	this->textureHeight = height;
+	this->createTextures();
+	this->historyHead = 0;
+	this->historyCount = 0;
+	return true;
+}
+
+
+bool OpenGL::canResizeTextures() const {
+	return true;
+}
+
+
+bool OpenGL::startRecording(const std::string& path, double fps) {
+	this->stopRecording();
+	int width = NULL;
+	int height = NULL;
+	glfwGetFramebufferSize(this->window, &width, &height);
+	if (!this->encoder.open(path, width, height, fps)) {
+		return false;
+	}
+	this->readbackWidth = width;
+	this->readbackHeight = height;
+	const GLsizeiptr frameBytes = static_cast<GLsizeiptr>(
+		this->readbackWidth * this->readbackHeight * 4
+	);
+	glCreateBuffers(OpenGL::readbackSlots, this->readbackBuffers.data());
+	for (const unsigned int buffer : this->readbackBuffers) {
+		glNamedBufferStorage(
+			buffer, frameBytes, nullptr, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT
+		);
+	}
+	this->readbackFences.fill(nullptr);
+	this->readbackHead = 0;
+	this->recordingStats = RecordingStats();
 	return true;
 }
 
 
+void OpenGL::stopRecording() {
+	if (!this->encoder.isOpen()) {
+		return;
+	}
+	for (size_t i = 0; i < OpenGL::readbackSlots; i++) {
+		const size_t slot = (this->readbackHead + i) % OpenGL::readbackSlots;
+		if (this->readbackFences[slot]) {
+			this->collectReadback(slot, OpenGL::readbackStopTimeout);
+		}
+	}
+	glDeleteBuffers(OpenGL::readbackSlots, this->readbackBuffers.data());
+	this->readbackBuffers.fill(NULL);
+	this->encoder.close();
+}
+
+
+bool OpenGL::isRecording() const {
+	return this->encoder.isOpen();
+}
+
+
+RecordingStats OpenGL::getRecordingStats() const {
+	RecordingStats stats = this->recordingStats;
+	stats.encoder = this->encoder.getStats();
+	return stats;
+}
+
+
 void OpenGL::render() {
+	this->updateTemporalUniforms();
 	glDrawElements(
 		GL_TRIANGLES, this->elementOffset, GL_UNSIGNED_INT, nullptr
 	);
@@ -125,8 +263,14 @@ void OpenGL::render() {
 
 
 void OpenGL::present() {
+	if (this->encoder.isOpen()) {
+		this->captureFrame();
+	}
 	glfwSwapBuffers(this->window);
-	glfwPollEvents();
+	if (this->retiredTex) {
+		glDeleteTextures(1, &this->retiredTex);
+		this->retiredTex = NULL;
+	}
 }
 
 
@@ -175,6 +319,22 @@ void OpenGL::createShaderProgram() {
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
 	glUseProgram(this->shader);
+	this->temporalModeLocation = glGetUniformLocation(this->shader, "temporalMode");
+	this->temporalDepthLocation = glGetUniformLocation(this->shader, "temporalDepth");
+	this->temporalDecayLocation = glGetUniformLocation(this->shader, "temporalDecay");
+	this->historyHeadLocation = glGetUniformLocation(this->shader, "historyHead");
+	glProgramUniform1i(
+		this->shader, glGetUniformLocation(this->shader, "historyBase"),
+		static_cast<int>(Renderer::maxTextures)
+	);
+	glProgramUniform1i(
+		this->shader, glGetUniformLocation(this->shader, "historySize"),
+		static_cast<int>(Renderer::maxHistoryLayers)
+	);
+	glProgramUniform1i(
+		this->shader, glGetUniformLocation(this->shader, "historyTarget"),
+		static_cast<int>(Renderer::historyTarget)
+	);
 }
 
 
@@ -216,7 +376,7 @@ void OpenGL::createTextures() {
 	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &this->tex);
 	glTextureStorage3D(
 		this->tex, 1, GL_RGBA8, this->textureWidth, 
-		this->textureHeight, Renderer::maxTextures
+		this->textureHeight, Renderer::maxTextures + Renderer::maxHistoryLayers
 	);
 	glTextureParameteri(this->tex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTextureParameteri(this->tex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -224,6 +384,90 @@ void OpenGL::createTextures() {
 }
 
 
+void OpenGL::updateTemporalUniforms() {
+	const bool isActive = (
+		this->temporalFilter.mode != TemporalMode::Off && this->historyCount > 0
+	);
+	const int depth = std::min(
+		this->temporalFilter.depth, static_cast<int>(this->historyCount)
+	);
+	glProgramUniform1i(
+		this->shader, this->temporalModeLocation,
+		isActive ? static_cast<int>(this->temporalFilter.mode) : 0
+	);
+	glProgramUniform1i(this->shader, this->temporalDepthLocation, depth);
+	glProgramUniform1f(
+		this->shader, this->temporalDecayLocation, this->temporalFilter.decay
+	);
+	glProgramUniform1i(
+		this->shader, this->historyHeadLocation,
+		static_cast<int>(this->historyHead)
+	);
+}
+
+
+void OpenGL::captureFrame() {
+	const auto startTime = std::chrono::steady_clock::now();
+	const size_t slot = this->readbackHead;
+	if (this->readbackFences[slot]) {
+		this->collectReadback(slot, 0);
+	}
+	int width = NULL;
+	int height = NULL;
+	glfwGetFramebufferSize(this->window, &width, &height);
+	if (width != this->readbackWidth || height != this->readbackHeight) {
+		this->recordingStats.readbackDrops += 1;
+	}
+	else {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, this->readbackBuffers[slot]);
+		glReadBuffer(GL_BACK);
+		glReadPixels(
+			0, 0, this->readbackWidth, this->readbackHeight,
+			GL_RGBA, GL_UNSIGNED_BYTE, nullptr
+		);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		this->readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		this->readbackTimes[slot] = startTime;
+		this->recordingStats.captured += 1;
+	}
+	this->readbackHead = (slot + 1) % OpenGL::readbackSlots;
+	const double millis = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime
+	).count();
+	this->recordingStats.captureMillis += FrameEncoder::statsSmoothing * (
+		millis - this->recordingStats.captureMillis
+	);
+}
+
+
+bool OpenGL::collectReadback(size_t slot, uint64_t timeout) {
+	GLsync& fence = this->readbackFences[slot];
+	const GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+	glDeleteSync(fence);
+	fence = nullptr;
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+		this->recordingStats.readbackDrops += 1;
+		return false;
+	}
+	const size_t frameBytes = static_cast<size_t>(
+		this->readbackWidth * this->readbackHeight * 4
+	);
+	const void* pixels = glMapNamedBufferRange(
+		this->readbackBuffers[slot], 0, frameBytes, GL_MAP_READ_BIT
+	);
+	if (!pixels) {
+		this->recordingStats.readbackDrops += 1;
+		return false;
+	}
+	this->encoder.submit(
+		pixels, static_cast<size_t>(this->readbackWidth) * 4,
+		this->readbackTimes[slot]
+	);
+	glUnmapNamedBuffer(this->readbackBuffers[slot]);
+	return true;
+}
+
+
 size_t OpenGL::numInstance = 0;
 
 
@@ -0,0 +1,125 @@
+#include "roi.h"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace kop;
+
+
+double RoiStats::getHitRate() const {
+	if (this->roiFrames == 0) {
+		return 0.0;
+	}
+	return static_cast<double>(this->hits) / this->roiFrames;
+}
+
+
+double RoiStats::getPixelSavings() const {
+	if (this->totalPixels == 0) {
+		return 0.0;
+	}
+	return 1.0 - static_cast<double>(this->processedPixels) / this->totalPixels;
+}
+
+
+void RoiTracker::setEnabled(bool enabled) {
+	if (enabled != this->enabled) {
+		this->reset();
+	}
+	this->enabled = enabled;
+}
+
+
+bool RoiTracker::isEnabled() const {
+	return this->enabled;
+}
+
+
+void RoiTracker::setRefreshInterval(int frames) {
+	this->refreshInterval = std::max(frames, 1);
+}
+
+
+int RoiTracker::getRefreshInterval() const {
+	return this->refreshInterval;
+}
+
+
+cv::Rect RoiTracker::predict(const cv::Size& frameSize) {
+	const cv::Rect frame(cv::Point(), frameSize);
+	if (frameSize != this->frameSize) {
+		this->reset();
+		this->frameSize = frameSize;
+	}
+	const bool isFullPass = (
+		!this->enabled || this->lastDetection.empty() ||
+		this->framesSinceFull >= this->refreshInterval
+	);
+	if (isFullPass) {
+		return frame;
+	}
+	const int margin = std::max(
+		RoiTracker::minMargin,
+		static_cast<int>(RoiTracker::marginScale * std::max(
+			this->lastDetection.width, this->lastDetection.height
+		))
+	);
+	const int marginX = margin + std::abs(this->motion.x);
+	const int marginY = margin + std::abs(this->motion.y);
+	cv::Rect roi = this->lastDetection + this->motion;
+	roi.x -= marginX;
+	roi.y -= marginY;
+	roi.width += 2 * marginX;
+	roi.height += 2 * marginY;
+	roi &= frame;
+	return roi.empty() ? frame : roi;
+}
+
+
+void RoiTracker::update(const cv::Rect& roi, const cv::Rect& detection) {
+	const bool isFullPass = roi.size() == this->frameSize;
+	this->stats.frames += 1;
+	this->stats.processedPixels += static_cast<uint64_t>(roi.area());
+	this->stats.totalPixels += static_cast<uint64_t>(this->frameSize.area());
+	if (isFullPass) {
+		this->framesSinceFull = 0;
+	}
+	else {
+		this->framesSinceFull += 1;
+		this->stats.roiFrames += 1;
+		if (detection.empty()) {
+			this->stats.losses += 1;
+		}
+		else {
+			this->stats.hits += 1;
+		}
+	}
+	if (detection.empty() || this->lastDetection.empty()) {
+		this->motion = cv::Point();
+	}
+	else {
+		const cv::Point currentCenter = (detection.tl() + detection.br()) / 2;
+		const cv::Point lastCenter = (
+			this->lastDetection.tl() + this->lastDetection.br()
+		) / 2;
+		this->motion = currentCenter - lastCenter;
+	}
+	this->lastDetection = detection;
+}
+
+
+void RoiTracker::reset() {
+	this->framesSinceFull = 0;
+	this->lastDetection = cv::Rect();
+	this->motion = cv::Point();
+	this->stats = RoiStats();
+}
+
+
+const cv::Rect& RoiTracker::getLastDetection() const {
+	return this->lastDetection;
+}
+
+
+const RoiStats& RoiTracker::getStats() const {
+	return this->stats;
+}
\ No newline at end of file
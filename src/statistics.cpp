@@ -0,0 +1,203 @@
+#include "statistics.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace kop;
+
+
+namespace {
+
+	constexpr const std::array<float, 3> channelScales = { 180.0f, 255.0f, 255.0f };
+
+
+	float findQuantile(const std::vector<double>& marginal, double target, int binSize) {
+		double cumulative = 0.0;
+		for (size_t bin = 0; bin < marginal.size(); bin++) {
+			const double next = cumulative + marginal[bin];
+			if (next >= target && marginal[bin] > 0.0) {
+				const double fraction = (target - cumulative) / marginal[bin];
+				return static_cast<float>((bin + fraction) * binSize);
+			}
+			cumulative = next;
+		}
+		return static_cast<float>(marginal.size() * binSize);
+	}
+
+}
+
+
+HsvStatistics::HsvStatistics()
+	: bandCounts(2 * HsvStatistics::numBands * HsvStatistics::numCells, 0),
+	  frameHistogram(HsvStatistics::numCells, 0.0f),
+	  regionHistogram(HsvStatistics::numCells, 0.0f)
+{
+
+}
+
+
+void HsvStatistics::setEnabled(bool enabled) {
+	if (enabled && !this->enabled) {
+		this->reset();
+	}
+	this->enabled = enabled;
+}
+
+
+bool HsvStatistics::isEnabled() const {
+	return this->enabled;
+}
+
+
+void HsvStatistics::setRegion(const cv::Rect& region) {
+	if (region == this->region) {
+		return;
+	}
+	this->region = region;
+	std::fill(this->regionHistogram.begin(), this->regionHistogram.end(), 0.0f);
+	this->regionTotal = 0.0;
+}
+
+
+const cv::Rect& HsvStatistics::getRegion() const {
+	return this->region;
+}
+
+
+void HsvStatistics::setDecay(float decay) {
+	this->decay = std::clamp(decay, 0.0f, 1.0f);
+}
+
+
+void HsvStatistics::reset() {
+	std::fill(this->frameHistogram.begin(), this->frameHistogram.end(), 0.0f);
+	std::fill(this->regionHistogram.begin(), this->regionHistogram.end(), 0.0f);
+	this->frameTotal = 0.0;
+	this->regionTotal = 0.0;
+}
+
+
+void HsvStatistics::beginFrame(const cv::Point& origin, int scale) {
+	this->origin = origin;
+	this->scale = std::max(scale, 1);
+	std::fill(this->bandCounts.begin(), this->bandCounts.end(), 0);
+}
+
+
+void HsvStatistics::accumulateRow(
+	int band, int y, const uchar* hsvRow, int width
+) {
+	uint32_t* frameCounts = this->bandCounts.data() +
+		2 * static_cast<size_t>(band) * HsvStatistics::numCells;
+	uint32_t* regionCounts = frameCounts + HsvStatistics::numCells;
+	for (int x = 0; x < width; x++) {
+		frameCounts[getCell(hsvRow + 3 * x)] += 1;
+	}
+	const int frameY = this->origin.y + y * this->scale;
+	if (
+		this->region.empty() ||
+		frameY < this->region.y || frameY >= this->region.y + this->region.height
+	) {
+		return;
+	}
+	const int regionBegin = std::max(
+		(this->region.x - this->origin.x + this->scale - 1) / this->scale, 0
+	);
+	const int regionEnd = std::min(
+		(this->region.x + this->region.width - this->origin.x + this->scale - 1) / this->scale,
+		width
+	);
+	for (int x = regionBegin; x < regionEnd; x++) {
+		regionCounts[getCell(hsvRow + 3 * x)] += 1;
+	}
+}
+
+
+void HsvStatistics::endFrame() {
+	const float weight = static_cast<float>(this->scale * this->scale);
+	double frameCount = 0.0;
+	double regionCount = 0.0;
+	for (size_t cell = 0; cell < HsvStatistics::numCells; cell++) {
+		uint32_t frameSum = 0;
+		uint32_t regionSum = 0;
+		for (int band = 0; band < HsvStatistics::numBands; band++) {
+			const uint32_t* counts = this->bandCounts.data() +
+				2 * static_cast<size_t>(band) * HsvStatistics::numCells;
+			frameSum += counts[cell];
+			regionSum += counts[HsvStatistics::numCells + cell];
+		}
+		this->frameHistogram[cell] = this->decay * this->frameHistogram[cell] +
+			weight * frameSum;
+		this->regionHistogram[cell] = this->decay * this->regionHistogram[cell] +
+			weight * regionSum;
+		frameCount += frameSum;
+		regionCount += regionSum;
+	}
+	this->frameTotal = this->decay * this->frameTotal + weight * frameCount;
+	this->regionTotal = this->decay * this->regionTotal + weight * regionCount;
+}
+
+
+bool HsvStatistics::calibrate(
+	float coverage,
+	std::array<float, 3>& lowerHSV, std::array<float, 3>& upperHSV
+) const {
+	if (this->regionTotal <= 0.0) {
+		return false;
+	}
+	std::array<std::vector<double>, 3> marginals;
+	for (int i = 0; i < 3; i++) {
+		marginals[i].assign(HsvStatistics::numBins[i], 0.0);
+	}
+	size_t cell = 0;
+	for (int h = 0; h < HsvStatistics::numBins[0]; h++) {
+		for (int s = 0; s < HsvStatistics::numBins[1]; s++) {
+			for (int v = 0; v < HsvStatistics::numBins[2]; v++) {
+				const double count = this->regionHistogram[cell++];
+				marginals[0][h] += count;
+				marginals[1][s] += count;
+				marginals[2][v] += count;
+			}
+		}
+	}
+	const double tail = 0.5 * (1.0 - std::clamp(coverage, 0.0f, 1.0f));
+	for (int i = 0; i < 3; i++) {
+		double total = 0.0;
+		for (const double count : marginals[i]) {
+			total += count;
+		}
+		const float lower = findQuantile(marginals[i], tail * total, binSizes[i]);
+		const float upper = findQuantile(marginals[i], (1.0 - tail) * total, binSizes[i]);
+		lowerHSV[i] = std::clamp(std::floor(lower) / channelScales[i], 0.0f, 1.0f);
+		upperHSV[i] = std::clamp(std::ceil(upper) / channelScales[i], 0.0f, 1.0f);
+	}
+	return true;
+}
+
+
+double HsvStatistics::getFrameTotal() const {
+	return this->frameTotal;
+}
+
+
+double HsvStatistics::getRegionTotal() const {
+	return this->regionTotal;
+}
+
+
+const std::vector<float>& HsvStatistics::getFrameHistogram() const {
+	return this->frameHistogram;
+}
+
+
+const std::vector<float>& HsvStatistics::getRegionHistogram() const {
+	return this->regionHistogram;
+}
+
+
+size_t HsvStatistics::getCell(const uchar* hsv) {
+	const int h = std::min(static_cast<int>(hsv[0]), 179) / HsvStatistics::binSizes[0];
+	const int s = hsv[1] / HsvStatistics::binSizes[1];
+	const int v = hsv[2] / HsvStatistics::binSizes[2];
+	return (static_cast<size_t>(h) * HsvStatistics::numBins[1] + s) *
+		HsvStatistics::numBins[2] + v;
+}
\ No newline at end of file
@@ -0,0 +1,290 @@
+#include "sweep.h"
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+using namespace kop;
+
+
+namespace {
+
+	constexpr const std::array<int, 3> channelLimits = { 180, 256, 256 };
+	constexpr const std::array<float, 3> channelScales = { 180.0f, 255.0f, 255.0f };
+
+
+	std::array<int, 3> getLowerBins(const HsvRange& range) {
+		std::array<int, 3> bins = {};
+		for (int i = 0; i < 3; i++) {
+			const int value = std::clamp(range.lower[i], 0, channelLimits[i] - 1);
+			bins[i] = value / HsvHistogram::binSizes[i];
+		}
+		return bins;
+	}
+
+
+	std::array<int, 3> getUpperBins(const HsvRange& range) {
+		std::array<int, 3> bins = {};
+		for (int i = 0; i < 3; i++) {
+			const int value = std::clamp(range.upper[i], 0, channelLimits[i] - 1);
+			bins[i] = value / HsvHistogram::binSizes[i];
+		}
+		return bins;
+	}
+
+}
+
+
+HsvRange HsvRange::fromNormalized(
+	const std::array<float, 3>& lowerHSV, const std::array<float, 3>& upperHSV
+) {
+	HsvRange range;
+	for (int i = 0; i < 3; i++) {
+		range.lower[i] = static_cast<int>(std::ceil(channelScales[i] * lowerHSV[i]));
+		range.upper[i] = static_cast<int>(std::floor(channelScales[i] * upperHSV[i]));
+	}
+	return range;
+}
+
+
+void HsvRange::toNormalized(
+	std::array<float, 3>& lowerHSV, std::array<float, 3>& upperHSV
+) const {
+	for (int i = 0; i < 3; i++) {
+		lowerHSV[i] = std::clamp(this->lower[i] / channelScales[i], 0.0f, 1.0f);
+		upperHSV[i] = std::clamp(this->upper[i] / channelScales[i], 0.0f, 1.0f);
+	}
+}
+
+
+HsvHistogram::HsvHistogram()
+	: counts(HsvHistogram::numCells, 0),
+	  table(HsvHistogram::numCells, 0)
+{
+
+}
+
+
+void HsvHistogram::reset() {
+	std::fill(this->counts.begin(), this->counts.end(), 0);
+	std::fill(this->table.begin(), this->table.end(), 0);
+	this->total = 0;
+}
+
+
+void HsvHistogram::accumulate(const cv::Mat& hsv, const cv::Mat& mask) {
+	CV_Assert(hsv.type() == CV_8UC3);
+	CV_Assert(mask.empty() || (mask.type() == CV_8UC1 && mask.size() == hsv.size()));
+	for (int y = 0; y < hsv.rows; y++) {
+		const uchar* pixels = hsv.ptr(y);
+		const uchar* maskRow = mask.empty() ? nullptr : mask.ptr(y);
+		for (int x = 0; x < hsv.cols; x++) {
+			if (maskRow && maskRow[x] == 0) {
+				continue;
+			}
+			const uchar* pixel = pixels + 3 * x;
+			const int h = std::min(static_cast<int>(pixel[0]), channelLimits[0] - 1);
+			this->counts[HsvHistogram::getIndex(
+				h / HsvHistogram::binSizes[0],
+				pixel[1] / HsvHistogram::binSizes[1],
+				pixel[2] / HsvHistogram::binSizes[2]
+			)] += 1;
+			this->total += 1;
+		}
+	}
+}
+
+
+void HsvHistogram::buildSummedTable() {
+	const auto& bins = HsvHistogram::numBins;
+	this->table = this->counts;
+	for (int h = 0; h < bins[0]; h++) {
+		for (int s = 0; s < bins[1]; s++) {
+			for (int v = 1; v < bins[2]; v++) {
+				this->table[getIndex(h, s, v)] += this->table[getIndex(h, s, v - 1)];
+			}
+		}
+	}
+	for (int h = 0; h < bins[0]; h++) {
+		for (int s = 1; s < bins[1]; s++) {
+			for (int v = 0; v < bins[2]; v++) {
+				this->table[getIndex(h, s, v)] += this->table[getIndex(h, s - 1, v)];
+			}
+		}
+	}
+	for (int h = 1; h < bins[0]; h++) {
+		for (int s = 0; s < bins[1]; s++) {
+			for (int v = 0; v < bins[2]; v++) {
+				this->table[getIndex(h, s, v)] += this->table[getIndex(h - 1, s, v)];
+			}
+		}
+	}
+}
+
+
+uint64_t HsvHistogram::getCount(const HsvRange& range) const {
+	const std::array<int, 3> low = getLowerBins(range);
+	const std::array<int, 3> high = getUpperBins(range);
+	if (low[0] > high[0] || low[1] > high[1] || low[2] > high[2]) {
+		return 0;
+	}
+	const auto at = [&](int h, int s, int v) -> int64_t {
+		if (h < 0 || s < 0 || v < 0) {
+			return 0;
+		}
+		return static_cast<int64_t>(this->table[getIndex(h, s, v)]);
+	};
+	const int h0 = low[0] - 1;
+	const int s0 = low[1] - 1;
+	const int v0 = low[2] - 1;
+	const int h1 = high[0];
+	const int s1 = high[1];
+	const int v1 = high[2];
+	const int64_t count = at(h1, s1, v1)
+		- at(h0, s1, v1) - at(h1, s0, v1) - at(h1, s1, v0)
+		+ at(h0, s0, v1) + at(h0, s1, v0) + at(h1, s0, v0)
+		- at(h0, s0, v0);
+	return static_cast<uint64_t>(count);
+}
+
+
+uint64_t HsvHistogram::getTotal() const {
+	return this->total;
+}
+
+
+size_t HsvHistogram::getIndex(int h, int s, int v) {
+	return (static_cast<size_t>(h) * HsvHistogram::numBins[1] + s) *
+		HsvHistogram::numBins[2] + v;
+}
+
+
+void ThresholdSweep::reset() {
+	this->frameHistogram.reset();
+	this->labelHistogram.reset();
+	this->frames = 0;
+	this->isLabelled = false;
+	this->isDirty = false;
+}
+
+
+void ThresholdSweep::accumulate(const cv::Mat& hsv, const cv::Mat& labels) {
+	this->frameHistogram.accumulate(hsv);
+	if (!labels.empty()) {
+		this->labelHistogram.accumulate(hsv, labels);
+		this->isLabelled = true;
+	}
+	this->frames += 1;
+	this->isDirty = true;
+}
+
+
+std::vector<SweepResult> ThresholdSweep::evaluate(
+	const std::vector<HsvRange>& candidates, size_t maxResults
+) {
+	if (this->isDirty) {
+		this->frameHistogram.buildSummedTable();
+		this->labelHistogram.buildSummedTable();
+		this->isDirty = false;
+	}
+	const double positives = static_cast<double>(this->labelHistogram.getTotal());
+	const double beta2 = ThresholdSweep::recallWeight * ThresholdSweep::recallWeight;
+	std::vector<SweepResult> results;
+	results.reserve(candidates.size());
+	for (const HsvRange& range : candidates) {
+		SweepResult result;
+		result.range = range;
+		result.pixels = this->frameHistogram.getCount(range);
+		result.truePositives = this->labelHistogram.getCount(range);
+		if (result.pixels > 0) {
+			result.precision = static_cast<double>(result.truePositives) / result.pixels;
+		}
+		if (positives > 0.0) {
+			result.recall = result.truePositives / positives;
+		}
+		const double denominator = beta2 * result.precision + result.recall;
+		if (denominator > 0.0) {
+			result.score = (1.0 + beta2) * result.precision * result.recall / denominator;
+		}
+		results.push_back(result);
+	}
+	const size_t numResults = std::min(maxResults, results.size());
+	const bool isLabelled = this->isLabelled;
+	std::partial_sort(
+		results.begin(), results.begin() + numResults, results.end(),
+		[isLabelled](const SweepResult& a, const SweepResult& b) {
+			if (!isLabelled) {
+				return a.pixels > b.pixels;
+			}
+			if (a.score != b.score) {
+				return a.score > b.score;
+			}
+			return a.pixels < b.pixels;
+		}
+	);
+	results.resize(numResults);
+	return results;
+}
+
+
+uint64_t ThresholdSweep::getFrames() const {
+	return this->frames;
+}
+
+
+bool ThresholdSweep::hasLabels() const {
+	return this->isLabelled;
+}
+
+
+std::vector<HsvRange> ThresholdSweep::generateCandidates(
+	const HsvRange& center, int steps, int stride
+) {
+	const std::array<int, 3> lowBins = getLowerBins(center);
+	const std::array<int, 3> highBins = getUpperBins(center);
+	const int numOffsets = 2 * steps + 1;
+	int numCandidates = 1;
+	for (int i = 0; i < 6; i++) {
+		numCandidates *= numOffsets;
+	}
+	std::vector<HsvRange> candidates;
+	candidates.reserve(numCandidates);
+	for (int index = 0; index < numCandidates; index++) {
+		HsvRange range;
+		bool isValid = true;
+		int digits = index;
+		for (int i = 0; i < 3 && isValid; i++) {
+			const int binSize = HsvHistogram::binSizes[i];
+			const int lastBin = HsvHistogram::numBins[i] - 1;
+			const int lowOffset = (digits % numOffsets - steps) * stride;
+			digits /= numOffsets;
+			const int highOffset = (digits % numOffsets - steps) * stride;
+			digits /= numOffsets;
+			const int low = std::clamp(lowBins[i] + lowOffset, 0, lastBin);
+			const int high = std::clamp(highBins[i] + highOffset, 0, lastBin);
+			isValid = low <= high;
+			range.lower[i] = low * binSize;
+			range.upper[i] = std::min(
+				high * binSize + binSize - 1, channelLimits[i] - 1
+			);
+		}
+		if (isValid) {
+			candidates.push_back(range);
+		}
+	}
+	std::sort(
+		candidates.begin(), candidates.end(),
+		[](const HsvRange& a, const HsvRange& b) {
+			return std::tie(a.lower, a.upper) < std::tie(b.lower, b.upper);
+		}
+	);
+	candidates.erase(
+		std::unique(
+			candidates.begin(), candidates.end(),
+			[](const HsvRange& a, const HsvRange& b) {
+				return a.lower == b.lower && a.upper == b.upper;
+			}
+		),
+		candidates.end()
+	);
+	return candidates;
+}
\ No newline at end of file
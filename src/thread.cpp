@@ -0,0 +1,121 @@
+#include "thread.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+using namespace kop;
+
+
+namespace {
+
+	bool parseCpuIndex(const std::string& text, int& cpu) {
+		try {
+			size_t length = 0;
+			cpu = std::stoi(text, &length);
+			return length == text.size() && cpu >= 0;
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+}
+
+
+bool kop::applyThreadOptions(const ThreadOptions& options) {
+	bool isApplied = true;
+#if defined(_WIN32)
+	if (options.affinityMask != 0) {
+		const DWORD_PTR mask = static_cast<DWORD_PTR>(options.affinityMask);
+		isApplied = SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+	}
+	if (options.realtimePriority > 0) {
+		isApplied = SetThreadPriority(
+			GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL
+		) && isApplied;
+	}
+#else
+	if (options.affinityMask != 0) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for (int cpu = 0; cpu < 64; cpu++) {
+			if (options.affinityMask & (uint64_t(1) << cpu)) {
+				CPU_SET(cpu, &cpus);
+			}
+		}
+		isApplied = pthread_setaffinity_np(
+			pthread_self(), sizeof(cpus), &cpus
+		) == 0;
+	}
+	if (options.realtimePriority > 0) {
+		sched_param param = {};
+		param.sched_priority = std::min(
+			options.realtimePriority, sched_get_priority_max(SCHED_FIFO)
+		);
+		isApplied = pthread_setschedparam(
+			pthread_self(), SCHED_FIFO, &param
+		) == 0 && isApplied;
+	}
+#endif
+	return isApplied;
+}
+
+
+bool kop::parseCpuList(const std::string& cpuList, uint64_t& mask) {
+	mask = 0;
+	std::stringstream ss(cpuList);
+	std::string item;
+	while (std::getline(ss, item, ',')) {
+		const size_t dash = item.find('-');
+		int first = 0;
+		int last = 0;
+		if (!parseCpuIndex(item.substr(0, dash), first)) {
+			return false;
+		}
+		if (dash == std::string::npos) {
+			last = first;
+		}
+		else if (!parseCpuIndex(item.substr(dash + 1), last)) {
+			return false;
+		}
+		for (int cpu = first; cpu <= last && cpu < 64; cpu++) {
+			mask |= uint64_t(1) << cpu;
+		}
+	}
+	return mask != 0;
+}
+
+
+double kop::getProcessCpuSeconds() {
+#if defined(_WIN32)
+	FILETIME creationTime = {};
+	FILETIME exitTime = {};
+	FILETIME kernelTime = {};
+	FILETIME userTime = {};
+	if (!GetProcessTimes(
+		GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime
+	)) {
+		return 0.0;
+	}
+	const auto toTicks = [](const FILETIME& time) {
+		return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	};
+	return (toTicks(kernelTime) + toTicks(userTime)) * 1.0e-7;
+#else
+	rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0.0;
+	}
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+		(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1.0e-6;
+#endif
+}
\ No newline at end of file
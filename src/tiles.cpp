@@ -0,0 +1,130 @@
+#include "tiles.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace kop;
+
+
+DirtyTiles::DirtyTiles() {
+	this->previous.allocator = cv::Mat::getStdAllocator();
+}
+
+
+void DirtyTiles::reset() {
+	this->previous.release();
+	this->dirty.clear();
+	this->dirtyRects.clear();
+	this->numDirty = 0;
+}
+
+
+void DirtyTiles::update(const cv::Mat& frame) {
+	CV_Assert(frame.dims == 2);
+	const bool isResized = (
+		this->previous.size() != frame.size() ||
+		this->previous.type() != frame.type()
+	);
+	const int tileSize = DirtyTiles::tileSize;
+	this->tilesX = (frame.cols + tileSize - 1) / tileSize;
+	this->tilesY = (frame.rows + tileSize - 1) / tileSize;
+	if (isResized) {
+		frame.copyTo(this->previous);
+		this->dirty.assign(static_cast<size_t>(this->tilesX) * this->tilesY, 1);
+	}
+	else {
+		this->dirty.assign(static_cast<size_t>(this->tilesX) * this->tilesY, 0);
+		const size_t elemSize = frame.elemSize();
+		const size_t rowBytes = frame.cols * elemSize;
+		cv::parallel_for_(cv::Range(0, this->tilesY), [&](const cv::Range& range) {
+			for (int tileY = range.start; tileY < range.end; tileY++) {
+				uint8_t* dirtyRow = this->dirty.data() + tileY * this->tilesX;
+				const int firstRow = tileY * tileSize;
+				const int lastRow = std::min(firstRow + tileSize, frame.rows);
+				for (int y = firstRow; y < lastRow; y++) {
+					const uchar* current = frame.ptr(y);
+					const uchar* stored = this->previous.ptr(y);
+					if (std::memcmp(current, stored, rowBytes) == 0) {
+						continue;
+					}
+					for (int tileX = 0; tileX < this->tilesX; tileX++) {
+						if (dirtyRow[tileX]) {
+							continue;
+						}
+						const size_t offset = tileX * tileSize * elemSize;
+						const size_t bytes = std::min(
+							tileSize * elemSize, rowBytes - offset
+						);
+						dirtyRow[tileX] = std::memcmp(
+							current + offset, stored + offset, bytes
+						) != 0;
+					}
+				}
+				for (int y = firstRow; y < lastRow; y++) {
+					for (int tileX = 0; tileX < this->tilesX; tileX++) {
+						if (!dirtyRow[tileX]) {
+							continue;
+						}
+						const size_t offset = tileX * tileSize * elemSize;
+						const size_t bytes = std::min(
+							tileSize * elemSize, rowBytes - offset
+						);
+						std::memcpy(
+							this->previous.ptr(y) + offset,
+							frame.ptr(y) + offset, bytes
+						);
+					}
+				}
+			}
+		});
+	}
+
+	this->dirtyRects.clear();
+	this->numDirty = 0;
+	for (int tileY = 0; tileY < this->tilesY; tileY++) {
+		int tileX = 0;
+		while (tileX < this->tilesX) {
+			if (!this->isDirty(tileX, tileY)) {
+				tileX++;
+				continue;
+			}
+			const int firstTile = tileX;
+			while (tileX < this->tilesX && this->isDirty(tileX, tileY)) {
+				tileX++;
+			}
+			this->numDirty += tileX - firstTile;
+			const cv::Rect rect(
+				firstTile * tileSize, tileY * tileSize,
+				(tileX - firstTile) * tileSize, tileSize
+			);
+			this->dirtyRects.push_back(rect & cv::Rect(0, 0, frame.cols, frame.rows));
+		}
+	}
+}
+
+
+bool DirtyTiles::isDirty(int tileX, int tileY) const {
+	return this->dirty[tileY * this->tilesX + tileX] != 0;
+}
+
+
+size_t DirtyTiles::getNumDirty() const {
+	return this->numDirty;
+}
+
+
+size_t DirtyTiles::getNumTiles() const {
+	return this->dirty.size();
+}
+
+
+double DirtyTiles::getDirtyRatio() const {
+	if (this->dirty.empty()) {
+		return 1.0;
+	}
+	return static_cast<double>(this->numDirty) / this->dirty.size();
+}
+
+
+const std::vector<cv::Rect>& DirtyTiles::getDirtyRects() const {
+	return this->dirtyRects;
+}
\ No newline at end of file
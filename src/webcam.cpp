@@ -0,0 +1,706 @@
+#include "webcam.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace kop;
+
+
+Webcam::Webcam(
+	unsigned int cameraId,
+	int width,
+	int height,
+	PixelFormat format
+)
+	: cameraId(cameraId),
+	  width(width),
+	  height(height),
+	  format(format)
+{
+	if (!this->openCamera()) {
+		this->width = NULL;
+		this->height = NULL;
+		return;
+	}
+	this->closeCamera();
+}
+
+
+Webcam::Webcam(const std::string& sourcePath, double fps)
+	: format(PixelFormat::MJPEG),
+	  sourcePath(sourcePath),
+	  sourceFps(fps),
+	  isReplay(FrameReplayer::isRecording(sourcePath))
+{
+	if (!this->openCamera()) {
+		return;
+	}
+	this->closeCamera();
+}
+
+
+Webcam::~Webcam() {
+	this->setActive(false);
+	this->stopRecording();
+}
+
+
+bool Webcam::isActive() const {
+	return this->stateActive.load();
+}
+
+
+void Webcam::setActive(bool newState) {
+	std::lock_guard<std::mutex> lock(this->activeLocker);
+	if (newState) {
+		if (this->streamer.joinable()) {
+			if (!this->stopRequested.load()) {
+				return;
+			}
+			this->streamer.join();
+		}
+		const size_t pool = (this->activePool + 1) % Webcam::numFramePools;
+		if (!this->reclaimPool(pool) || !this->allocateBuffers()) {
+			return;
+		}
+		this->stopRequested = false;
+		this->captureLost = false;
+		this->streamer = std::thread(&Webcam::streamingThread, this);
+	}
+	else if (this->streamer.joinable()) {
+		{
+			std::lock_guard<std::mutex> frameLock(this->frameLocker);
+			this->stopRequested = true;
+		}
+		this->frameSignal.notify_all();
+		this->streamer.join();
+	}
+}
+
+
+int Webcam::getWidth() const {
+	return this->width;
+}
+
+
+int Webcam::getHeight() const {
+	return this->height;
+}
+
+
+PixelFormat Webcam::getFormat() const {
+	return this->format;
+}
+
+
+CaptureMode Webcam::getMode() const {
+	CaptureMode mode;
+	mode.width = this->width;
+	mode.height = this->height;
+	mode.format = this->format;
+	return mode;
+}
+
+
+bool Webcam::requestMode(const CaptureMode& mode) {
+	const bool isSwitchable = (
+		!this->isReplay && this->sourcePath.empty() &&
+		mode.width > 0 && mode.height > 0
+	);
+	if (!isSwitchable) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(this->modeLocker);
+	this->pendingMode = mode;
+	this->switchStart = std::chrono::steady_clock::now();
+	this->modePending = true;
+	this->modeSwitching = true;
+	return true;
+}
+
+
+bool Webcam::isSwitchingMode() const {
+	return this->modeSwitching.load();
+}
+
+
+void Webcam::getFrame(cv::Mat& image) const {
+	const int handle = this->acquireFrame();
+	if (handle == FramePool::nullHandle) {
+		return;
+	}
+	if (isYuvFormat(this->getFrameMode(handle).format)) {
+		this->readFrame(handle).copyTo(image);
+	}
+	else {
+		cv::flip(this->readFrame(handle), image, -1);
+	}
+	this->releaseFrame(handle);
+}
+
+
+int Webcam::acquireFrame() const {
+	std::lock_guard<std::mutex> lock(this->frameLocker);
+	if (this->latestHandle == FramePool::nullHandle) {
+		return FramePool::nullHandle;
+	}
+	this->framePools[this->latestHandle % Webcam::numFramePools].retain(
+		this->latestHandle / Webcam::numFramePools
+	);
+	return this->latestHandle;
+}
+
+
+const cv::Mat& Webcam::readFrame(int handle) const {
+	return this->framePools[handle % Webcam::numFramePools].at(
+		handle / Webcam::numFramePools
+	);
+}
+
+
+const CaptureMode& Webcam::getFrameMode(int handle) const {
+	return this->poolModes[handle % Webcam::numFramePools];
+}
+
+
+void Webcam::releaseFrame(int handle) const {
+	if (handle == FramePool::nullHandle) {
+		return;
+	}
+	this->framePools[handle % Webcam::numFramePools].release(
+		handle / Webcam::numFramePools
+	);
+}
+
+
+int64_t Webcam::getFrameTimestamp() const {
+	std::lock_guard<std::mutex> lock(this->frameLocker);
+	return this->frameTimestamp;
+}
+
+
+uint64_t Webcam::getFrameSequence() const {
+	return this->numFrames.load();
+}
+
+
+uint64_t Webcam::getNotifiedSequence() const {
+	return this->notifiedSequence.load();
+}
+
+
+void Webcam::setFrameListener(FrameListener listener) {
+	this->frameListener = listener;
+}
+
+
+bool Webcam::waitFrame(
+	uint64_t lastSequence, std::chrono::milliseconds timeout
+) const {
+	std::unique_lock<std::mutex> lock(this->frameLocker);
+	return this->frameSignal.wait_for(lock, timeout, [&]() {
+		return this->stopRequested.load() || this->numFrames.load() > lastSequence;
+	}) && this->numFrames.load() > lastSequence;
+}
+
+
+CaptureStats Webcam::getCaptureStats() const {
+	CaptureStats stats;
+	stats.frames = this->numFrames.load();
+	stats.droppedFrames = this->numDroppedFrames.load();
+	stats.fallbackCopies = this->numFallbackCopies.load();
+	stats.steadyAllocations = this->numSteadyAllocations.load();
+	stats.modeSwitches = this->numModeSwitches.load();
+	stats.failedSwitches = this->numFailedSwitches.load();
+	stats.switchMillis = this->switchMillis.load();
+	stats.captureLost = this->captureLost.load();
+	return stats;
+}
+
+
+void Webcam::setHugePages(bool enabled) {
+	this->hugePages = enabled;
+}
+
+
+void Webcam::setThreadOptions(const ThreadOptions& options) {
+	this->threadOptions = options;
+}
+
+
+void Webcam::setReplayPacing(bool paced) {
+	this->replayPaced = paced;
+}
+
+
+bool Webcam::startRecording(const std::string& path) {
+	const PixelFormat recordedFormat = (this->format == PixelFormat::MJPEG)
+		? PixelFormat::BGR
+		: this->format;
+	std::lock_guard<std::mutex> lock(this->recordLocker);
+	return this->recorder.open(path, this->width, this->height, recordedFormat);
+}
+
+
+void Webcam::stopRecording() {
+	std::lock_guard<std::mutex> lock(this->recordLocker);
+	this->recorder.close();
+}
+
+
+bool Webcam::isRecording() const {
+	std::lock_guard<std::mutex> lock(this->recordLocker);
+	return this->recorder.isOpen();
+}
+
+
+uint64_t Webcam::getRecordedFrames() const {
+	std::lock_guard<std::mutex> lock(this->recordLocker);
+	return this->recorder.getNumFrames();
+}
+
+
+void Webcam::openSettings() {
+	this->camera.set(cv::CAP_PROP_SETTINGS, 1);
+}
+
+
+void Webcam::setMafOrder(size_t order) {
+	if (order < 0 || order >= Webcam::maxMafOrder) {
+		return;
+	}
+	this->mafOrder = order;
+}
+
+
+const cv::Scalar Webcam::nullColor = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+
+bool Webcam::openCamera() {
+	if (this->isReplay) {
+		if (!this->replayer.open(this->sourcePath)) {
+			return false;
+		}
+		this->width = this->replayer.getWidth();
+		this->height = this->replayer.getHeight();
+		this->format = this->replayer.getFormat();
+		return true;
+	}
+	if (this->format == PixelFormat::MJPEG) {
+		const bool isOpened = this->sourcePath.empty()
+			? this->mjpegReader.openCamera(this->cameraId, this->width, this->height)
+			: this->mjpegReader.openFile(this->sourcePath, this->sourceFps);
+		if (!isOpened) {
+			return false;
+		}
+		this->width = this->mjpegReader.getWidth();
+		this->height = this->mjpegReader.getHeight();
+		return true;
+	}
+	this->camera.open(this->cameraId);
+	if (!this->camera.isOpened()) {
+		this->camera.release();
+		return false;
+	}
+	return this->configureCamera();
+}
+
+
+bool Webcam::configureCamera() {
+	if (this->format == PixelFormat::YUYV) {
+		this->camera.set(
+			cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('Y', 'U', 'Y', 'V')
+		);
+	}
+	else if (this->format == PixelFormat::NV12) {
+		this->camera.set(
+			cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('N', 'V', '1', '2')
+		);
+	}
+	if (this->format != PixelFormat::BGR) {
+		this->camera.set(cv::CAP_PROP_CONVERT_RGB, 0);
+	}
+	this->camera.set(cv::CAP_PROP_FRAME_WIDTH, this->width);
+	this->camera.set(cv::CAP_PROP_FRAME_HEIGHT, this->height);
+	this->width = static_cast<int>(
+		this->camera.get(cv::CAP_PROP_FRAME_WIDTH)
+		);
+	this->height = static_cast<int>(
+		this->camera.get(cv::CAP_PROP_FRAME_HEIGHT)
+		);
+	return this->width > 0 && this->height > 0;
+}
+
+
+void Webcam::closeCamera() {
+	this->camera.release();
+	this->mjpegReader.release();
+	this->replayer.close();
+}
+
+
+bool Webcam::allocateBuffers() {
+	int captureRows = this->height;
+	int captureCols = this->width;
+	int captureType = CV_8UC3;
+	int frameRows = this->height;
+	int frameCols = this->width;
+	int frameType = CV_8UC3;
+	if (this->format == PixelFormat::YUYV) {
+		captureRows = 1;
+		captureCols = this->width * this->height * 2;
+		captureType = CV_8UC1;
+		frameType = CV_8UC2;
+	}
+	else if (this->format == PixelFormat::NV12) {
+		captureRows = 1;
+		captureCols = this->width * this->height * 3 / 2;
+		captureType = CV_8UC1;
+		frameRows = this->height * 3 / 2;
+		frameType = CV_8UC1;
+	}
+	const size_t pool = (this->activePool + 1) % Webcam::numFramePools;
+	const bool isAllocated = (
+		this->capturePool.allocate(
+			this->captureHeaders.size(), captureRows, captureCols,
+			captureType, this->hugePages
+		) &&
+		this->framePools[pool].allocate(
+			Webcam::numPublishBuffers, frameRows, frameCols,
+			frameType, this->hugePages
+		)
+	);
+	if (!isAllocated) {
+		return false;
+	}
+	this->poolModes[pool] = this->getMode();
+	this->activePool = pool;
+	for (size_t i = 0; i < this->captureHeaders.size(); i++) {
+		const int handle = this->capturePool.lease();
+		this->captureHeaders[i] = this->capturePool.at(handle);
+		this->mafHeaders[i] = this->captureHeaders[i].reshape(
+			CV_MAT_CN(frameType), frameRows
+		);
+	}
+	this->mafFrame = this->mafHeaders[Webcam::maxMafOrder];
+	return true;
+}
+
+
+bool Webcam::reclaimPool(size_t pool) {
+	{
+		std::lock_guard<std::mutex> lock(this->frameLocker);
+		const bool isInPool = (
+			this->latestHandle != FramePool::nullHandle &&
+			static_cast<size_t>(this->latestHandle) % Webcam::numFramePools == pool
+		);
+		if (isInPool) {
+			this->releaseFrame(this->latestHandle);
+			this->latestHandle = FramePool::nullHandle;
+		}
+	}
+	const auto deadline = std::chrono::steady_clock::now() + Webcam::poolDrainTimeout;
+	while (this->framePools[pool].getNumLeased() > 0) {
+		if (std::chrono::steady_clock::now() >= deadline) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+
+bool Webcam::applyPendingMode() {
+	CaptureMode mode;
+	{
+		std::lock_guard<std::mutex> lock(this->modeLocker);
+		if (!this->modePending.load()) {
+			return false;
+		}
+		mode = this->pendingMode;
+		this->modePending = false;
+	}
+	const size_t pool = (this->activePool + 1) % Webcam::numFramePools;
+	if (!this->reclaimPool(pool)) {
+		this->numFailedSwitches += 1;
+		this->modeSwitching = false;
+		return true;
+	}
+	this->stopRecording();
+	const CaptureMode previous = this->getMode();
+	if (this->switchMode(mode)) {
+		return true;
+	}
+	this->numFailedSwitches += 1;
+	this->modeSwitching = false;
+	if (!this->switchMode(previous)) {
+		this->captureLost = true;
+		return false;
+	}
+	return true;
+}
+
+
+bool Webcam::switchMode(const CaptureMode& mode) {
+	const bool isInPlace = (
+		mode.format == this->format && this->format != PixelFormat::MJPEG &&
+		this->camera.isOpened()
+	);
+	this->width = mode.width;
+	this->height = mode.height;
+	this->format = mode.format;
+	if (isInPlace) {
+		if (!this->configureCamera()) {
+			return false;
+		}
+	}
+	else {
+		this->closeCamera();
+		if (!this->openCamera()) {
+			return false;
+		}
+	}
+	return this->allocateBuffers();
+}
+
+
+void Webcam::streamingThread() {
+	if (!applyThreadOptions(this->threadOptions)) {
+		std::cerr << "Webcam: Cannot apply capture thread options." << std::endl;
+	}
+	if (!this->openCamera()) {
+		this->captureLost = true;
+		this->stopRequested = true;
+		return;
+	}
+	this->stateActive = true;
+	this->threadLoop();
+	this->stateActive = false;
+	this->stopRequested = true;
+	this->closeCamera();
+	this->frameSignal.notify_all();
+}
+
+
+void Webcam::threadLoop() {
+	do {
+		this->mafBuffer = {};
+		this->mafIter = 0;
+		if (this->isReplay) {
+			this->replayLoop();
+		}
+		else if (this->format == PixelFormat::MJPEG) {
+			this->mjpegLoop();
+		}
+		else {
+			this->cameraLoop();
+		}
+	} while (!this->stopRequested.load() && this->applyPendingMode());
+}
+
+
+void Webcam::cameraLoop() {
+	const auto startTime = std::chrono::steady_clock::now();
+	cv::Mat captured;
+	cv::Mat reshaped;
+	while (
+		this->camera.isOpened() && !this->stopRequested.load() &&
+		!this->modePending.load()
+	) {
+		const cv::Mat& header = this->captureHeaders[this->mafIter];
+		captured = header;
+		this->camera >> captured;
+		const int64_t timestamp = std::chrono::duration_cast<
+			std::chrono::microseconds
+		>(std::chrono::steady_clock::now() - startTime).count();
+		cv::Mat& buffer = this->mafBuffer[this->mafIter];
+		buffer = this->mafHeaders[this->mafIter];
+		if (captured.data != header.data) {
+			this->numFallbackCopies += 1;
+			const bool isReshaped = reshapeNativeFrame(
+				captured, this->format, this->width, this->height, reshaped
+			);
+			const bool isMatching = (
+				isReshaped && reshaped.size() == buffer.size() &&
+				reshaped.type() == buffer.type()
+			);
+			if (isMatching) {
+				reshaped.copyTo(buffer);
+			}
+			else {
+				buffer = cv::Mat();
+			}
+		}
+		this->commitFrame(timestamp);
+	}
+}
+
+
+void Webcam::mjpegLoop() {
+	const size_t numWorkers = std::max(
+		std::thread::hardware_concurrency(), 2u
+	) - 1;
+	MjpegDecoder decoder(
+		this->width, this->height, numWorkers, 2 * numWorkers + 1
+	);
+	std::vector<unsigned char> packet;
+	int64_t timestamp = 0;
+	while (
+		this->mjpegReader.isOpened() && !this->stopRequested.load() &&
+		!this->modePending.load()
+	) {
+		if (!this->mjpegReader.read(packet, timestamp)) {
+			break;
+		}
+		while (!decoder.submit(packet.data(), packet.size(), timestamp, false)) {
+			this->drainDecoder(decoder, true);
+		}
+		while (this->drainDecoder(decoder, false)) {}
+	}
+	while (
+		!this->stopRequested.load() && !this->modePending.load() &&
+		this->drainDecoder(decoder, true)
+	) {}
+}
+
+
+void Webcam::replayLoop() {
+	const auto startTime = std::chrono::steady_clock::now();
+	const uint64_t numFrames = this->replayer.getNumFrames();
+	int64_t firstTimestamp = 0;
+	for (uint64_t i = 0; i < numFrames && !this->stopRequested.load(); i++) {
+		int64_t timestamp = 0;
+		cv::Mat& buffer = this->mafBuffer[this->mafIter];
+		if (!this->replayer.readFrame(i, buffer, timestamp)) {
+			buffer = cv::Mat();
+			continue;
+		}
+		if (i == 0) {
+			firstTimestamp = timestamp;
+		}
+		if (this->replayPaced) {
+			std::this_thread::sleep_until(
+				startTime + std::chrono::microseconds(timestamp - firstTimestamp)
+			);
+		}
+		this->commitFrame(timestamp);
+	}
+	this->mafBuffer = {};
+}
+
+
+bool Webcam::drainDecoder(MjpegDecoder& decoder, bool wait) {
+	cv::Mat decoded;
+	int64_t timestamp = 0;
+	if (!decoder.acquire(decoded, timestamp, wait)) {
+		return false;
+	}
+	const size_t index = this->mafIter;
+	const bool isDirect = this->mafOrder.load() == 1;
+	if (isDirect) {
+		this->mafBuffer[index] = decoded;
+	}
+	else {
+		this->mafBuffer[index] = this->mafHeaders[index];
+		decoded.copyTo(this->mafBuffer[index]);
+	}
+	this->commitFrame(timestamp);
+	if (isDirect) {
+		this->mafBuffer[index] = cv::Mat();
+	}
+	decoder.release();
+	return true;
+}
+
+
+void Webcam::commitFrame(int64_t timestamp) {
+	{
+		std::lock_guard<std::mutex> lock(this->recordLocker);
+		if (this->recorder.isOpen()) {
+			this->recorder.append(this->mafBuffer[this->mafIter], timestamp);
+		}
+	}
+	const size_t mafCurrentOrder = this->mafOrder.load();
+	const size_t newest = this->mafIter;
+	this->mafIter += 1;
+	if (this->mafIter >= mafCurrentOrder) {
+		this->mafIter = 0;
+	}
+	const cv::Mat* source = &this->mafFrame;
+	if (mafCurrentOrder == 1) {
+		if (this->mafBuffer[newest].empty()) {
+			return;
+		}
+		source = &this->mafBuffer[newest];
+	}
+	else if (!this->movingAverageFilter(mafCurrentOrder, this->mafFrame, this->mafBuffer)) {
+		return;
+	}
+	const int poolHandle = this->framePools[this->activePool].lease();
+	if (poolHandle == FramePool::nullHandle) {
+		this->numDroppedFrames += 1;
+		return;
+	}
+	const int handle = static_cast<int>(
+		poolHandle * Webcam::numFramePools + this->activePool
+	);
+	cv::Mat published = this->readFrame(handle);
+	if (isYuvFormat(this->format)) {
+		source->copyTo(published);
+	}
+	else {
+		cv::cvtColor(*source, published, cv::COLOR_BGR2RGB);
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->frameLocker);
+		this->releaseFrame(this->latestHandle);
+		this->latestHandle = handle;
+		this->frameTimestamp = timestamp;
+		this->numFrames += 1;
+	}
+	this->frameSignal.notify_all();
+	if (this->modeSwitching.load()) {
+		std::lock_guard<std::mutex> lock(this->modeLocker);
+		if (!this->modePending.load()) {
+			this->switchMillis = std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - this->switchStart
+			).count();
+			this->numModeSwitches += 1;
+			this->modeSwitching = false;
+		}
+	}
+	const FrameListener listener = this->frameListener.load();
+	if (listener) {
+		this->notifiedSequence = this->numFrames.load();
+		listener();
+	}
+	if (this->numFrames <= Webcam::maxMafOrder) {
+		this->steadyAllocationBase = CountingAllocator::getThreadAllocations();
+	}
+	this->numSteadyAllocations = (
+		CountingAllocator::getThreadAllocations() - this->steadyAllocationBase
+	);
+}
+
+
+bool Webcam::movingAverageFilter(
+	size_t order, cv::Mat& image, 
+	std::array<cv::Mat, maxMafOrder>& buffer
+) {
+	const float weight = 1.0f / order;
+	if (buffer[0].empty()) {
+		return false;
+	}
+	image.create(buffer[0].size(), buffer[0].type());
+	image.setTo(Webcam::nullColor);
+	for (size_t i = 0; i < order; i++) {
+		const cv::Mat& bufferImage = buffer[i];
+		if (bufferImage.empty()) {
+			return false;
+		}
+		cv::addWeighted(image, 1.0, bufferImage, weight, 0.0, image);
+	}
+	return true;
+}
\ No newline at end of file
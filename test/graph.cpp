@@ -0,0 +1,51 @@
+#include "graph.h"
+#include <opencv2/core.hpp>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+using namespace kop;
+
+
+namespace {
+
+	const char* const temporalGraph =
+		"frame = source\n"
+		"a = blur frame type=box radius=1\n"
+		"b = blur a type=box radius=1\n"
+		"t = temporal b decay=0.5\n"
+		"smoothed = output t\n";
+
+
+	bool check(bool condition, const char* message) {
+		if (!condition) {
+			std::cerr << "FAILED: " << message << std::endl;
+		}
+		return condition;
+	}
+
+}
+
+
+int main() {
+	ProcessingGraph graph;
+	std::stringstream stream(temporalGraph);
+	if (!check(graph.parse(stream), "temporal graph parses")) {
+		std::cerr << graph.getError() << std::endl;
+		return 1;
+	}
+	const cv::Mat first(32, 32, CV_8UC3, cv::Scalar(100, 100, 100));
+	const cv::Mat second(32, 32, CV_8UC3, cv::Scalar(200, 200, 200));
+	bool isPassed = check(graph.run(first, false), "first frame runs");
+	isPassed &= check(graph.run(second, false), "second frame runs");
+	const cv::Mat& smoothed = graph.getOutput("smoothed");
+	isPassed &= check(!smoothed.empty(), "temporal output exists");
+	if (!smoothed.empty()) {
+		const cv::Scalar mean = cv::mean(smoothed);
+		isPassed &= check(
+			std::abs(mean[0] - 150.0) < 1.0,
+			"temporal stage blends the new frame with its history"
+		);
+	}
+	return isPassed ? 0 : 1;
+}
\ No newline at end of file
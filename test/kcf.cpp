@@ -0,0 +1,90 @@
+#include "kcf.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+	constexpr const int frameWidth = 64;
+	constexpr const int frameHeight = 48;
+
+
+	bool check(bool condition, const char* message) {
+		if (!condition) {
+			std::cerr << "FAILED: " << message << std::endl;
+		}
+		return condition;
+	}
+
+
+	bool hasError(const kcf_processor* processor) {
+		return std::strlen(kcf_last_error(processor)) > 0;
+	}
+
+
+	std::vector<uint8_t> makeFrame() {
+		std::vector<uint8_t> pixels(static_cast<size_t>(frameWidth) * frameHeight * 3);
+		for (int y = 0; y < frameHeight; y++) {
+			for (int x = 0; x < frameWidth; x++) {
+				uint8_t* pixel = &pixels[(static_cast<size_t>(y) * frameWidth + x) * 3];
+				const bool isRed = x < frameWidth / 2;
+				pixel[0] = isRed ? 0 : 255;
+				pixel[1] = 0;
+				pixel[2] = isRed ? 255 : 0;
+			}
+		}
+		return pixels;
+	}
+
+}
+
+
+int main() {
+	kcf_processor* processor = kcf_create();
+	if (!check(processor != nullptr, "processor is created")) {
+		return 1;
+	}
+	bool isPassed = true;
+	kcf_image mask = {};
+	isPassed &= check(kcf_get_mask(processor, &mask) != 0, "no mask before processing");
+	isPassed &= check(hasError(processor), "missing mask sets an error");
+	isPassed &= check(kcf_set_blur(processor, 0, -1) != 0, "negative blur size is rejected");
+	isPassed &= check(hasError(processor), "negative blur size sets an error");
+	isPassed &= check(kcf_set_blur(processor, 0, 100) != 0, "huge blur size is rejected");
+	isPassed &= check(kcf_set_blur(processor, 0, 3) == 0, "valid blur size is accepted");
+
+	const float lower[3] = { 0.0f, 0.5f, 0.5f };
+	const float upper[3] = { 0.05f, 1.0f, 1.0f };
+	isPassed &= check(kcf_set_range(processor, lower, upper) == 0, "range is set");
+	std::vector<uint8_t> pixels = makeFrame();
+	kcf_frame frame = {};
+	frame.data = pixels.data();
+	frame.width = frameWidth;
+	frame.height = frameHeight;
+	frame.stride = frameWidth * 3;
+	frame.format = KCF_FORMAT_BGR;
+	if (!check(kcf_process(processor, &frame) == 0, "synthetic frame is processed")) {
+		std::cerr << kcf_last_error(processor) << std::endl;
+		kcf_destroy(processor);
+		return 1;
+	}
+	isPassed &= check(!hasError(processor), "successful processing clears the error");
+	isPassed &= check(kcf_get_mask(processor, nullptr) != 0, "mask needs an output image");
+	if (check(kcf_get_mask(processor, &mask) == 0, "mask is exported")) {
+		isPassed &= check(
+			mask.width == frameWidth && mask.height == frameHeight && mask.channels == 1,
+			"mask matches the frame size"
+		);
+		const int y = frameHeight / 2;
+		const uint8_t* row = mask.data + static_cast<size_t>(y) * mask.stride;
+		isPassed &= check(row[frameWidth / 4] == 255, "red half is inside the range");
+		isPassed &= check(row[frameWidth * 3 / 4] == 0, "blue half is outside the range");
+	}
+	else {
+		isPassed = false;
+	}
+	kcf_destroy(processor);
+	return isPassed ? 0 : 1;
+}
\ No newline at end of file
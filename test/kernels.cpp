@@ -0,0 +1,123 @@
+#include "kernels.h"
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace kop;
+
+
+namespace {
+
+	constexpr const int rowLength = 333;
+
+
+	struct KernelOutput {
+	public:
+		std::vector<unsigned char> box;
+		std::vector<int> boxSum;
+		std::vector<unsigned char> stack;
+		std::vector<int> stackSums;
+		std::vector<float> recursive;
+	};
+
+
+	struct KernelInput {
+	public:
+		std::vector<unsigned char> rows[3];
+		std::vector<float> weights[3];
+	};
+
+
+	KernelInput makeInput() {
+		std::mt19937 random(42);
+		KernelInput input;
+		for (int i = 0; i < 3; i++) {
+			input.rows[i].resize(rowLength);
+			input.weights[i].resize(rowLength);
+			for (int x = 0; x < rowLength; x++) {
+				input.rows[i][x] = static_cast<unsigned char>(random() & 255);
+				input.weights[i][x] = static_cast<float>(random() % 25500) / 100.0f;
+			}
+		}
+		return input;
+	}
+
+
+	KernelOutput runKernels(const BlurKernels& kernels, const KernelInput& input) {
+		KernelOutput output;
+		const int reciprocal = (1 << fixedShift) / 9;
+		output.box.assign(rowLength, 0);
+		output.boxSum.assign(rowLength, 255 * 4);
+		kernels.boxColumnStep(
+			input.rows[0].data(), input.rows[1].data(), output.boxSum.data(),
+			output.box.data(), rowLength, reciprocal
+		);
+		const int stackReciprocal = (1 << fixedShift) / 16;
+		std::vector<int> sum(rowLength, 255 * 8);
+		std::vector<int> sumIn(rowLength, 255 * 2);
+		std::vector<int> sumOut(rowLength, 255 * 3);
+		output.stack.assign(rowLength, 0);
+		kernels.stackColumnStep(
+			input.rows[0].data(), input.rows[1].data(), input.rows[2].data(),
+			sum.data(), sumIn.data(), sumOut.data(), output.stack.data(),
+			rowLength, stackReciprocal
+		);
+		output.stackSums = sum;
+		output.stackSums.insert(output.stackSums.end(), sumIn.begin(), sumIn.end());
+		output.stackSums.insert(output.stackSums.end(), sumOut.begin(), sumOut.end());
+		output.recursive.assign(rowLength, 12.5f);
+		kernels.recursiveColumnStep(
+			input.weights[0].data(), input.weights[1].data(), input.weights[2].data(),
+			output.recursive.data(), rowLength, 0.27f, 1.31f, -0.72f, 0.14f
+		);
+		return output;
+	}
+
+
+	bool check(bool condition, const std::string& message) {
+		if (!condition) {
+			std::cerr << "FAILED: " << message << std::endl;
+		}
+		return condition;
+	}
+
+
+	bool compare(const std::string& name, const KernelOutput& output, const KernelOutput& baseline) {
+		bool isPassed = check(output.box == baseline.box, name + " box output");
+		isPassed &= check(output.boxSum == baseline.boxSum, name + " box sums");
+		isPassed &= check(output.stack == baseline.stack, name + " stack output");
+		isPassed &= check(output.stackSums == baseline.stackSums, name + " stack sums");
+		isPassed &= check(
+			std::memcmp(
+				output.recursive.data(), baseline.recursive.data(),
+				rowLength * sizeof(float)
+			) == 0,
+			name + " recursive output"
+		);
+		return isPassed;
+	}
+
+}
+
+
+int main() {
+	const KernelInput input = makeInput();
+	const KernelOutput baseline = runKernels(getBaselineBlurKernels(), input);
+	const CpuLevel level = getCpuLevel();
+	std::cout << "CPU level: " << getCpuLevelName(level) << std::endl;
+	bool isPassed = compare("dispatched", runKernels(getBlurKernels(), input), baseline);
+#if defined(KOP_CPU_DISPATCH)
+	if (level >= CpuLevel::Sse41) {
+		isPassed &= compare("SSE4.1", runKernels(getSse41BlurKernels(), input), baseline);
+	}
+	if (level >= CpuLevel::Avx2) {
+		isPassed &= compare("AVX2", runKernels(getAvx2BlurKernels(), input), baseline);
+	}
+	if (level >= CpuLevel::Avx512) {
+		isPassed &= compare("AVX-512", runKernels(getAvx512BlurKernels(), input), baseline);
+	}
+#endif
+	return isPassed ? 0 : 1;
+}
\ No newline at end of file